@@ -0,0 +1,168 @@
+#ifndef BOO_TASKSCHEDULER_HPP
+#define BOO_TASKSCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "ThreadLocalPtr.hpp"
+
+namespace boo
+{
+
+/** Lanes are serviced strictly in order. High serves per-frame work such as
+ *  spatialization, Normal serves loading (shader compiles, commit staging) */
+enum class TaskPriority
+{
+    High,
+    Normal,
+    Background
+};
+
+/** Completion counter for fork/join; must outlive every task submitted against it */
+class TaskGroup
+{
+    friend class TaskScheduler;
+    std::atomic_size_t m_pending = {0};
+    /* Lowest priority (highest lane index) submitted; bounds what a waiter helps with */
+    std::atomic_size_t m_lowestLane = {0};
+public:
+    bool done() const {return m_pending.load(std::memory_order_acquire) == 0;}
+};
+
+/** Work-stealing thread pool with one worker per hardware thread.
+ *  Each worker owns a bounded deque per priority lane; it runs its own work
+ *  newest-first and steals the oldest work from its peers when idle. Tasks
+ *  submitted from outside the pool enter a shared injection lane. Submission
+ *  of plain function/context tasks never allocates, but lanes are mutex-guarded,
+ *  so it is not lock-free; a full lane runs the task inline on the submitting thread. */
+class TaskScheduler
+{
+public:
+    using TaskFunc = void(*)(void* ctx);
+
+private:
+    struct Task
+    {
+        TaskFunc m_func;
+        void* m_ctx;
+        TaskGroup* m_group;
+    };
+
+    static constexpr size_t PriorityCount = 3;
+    static constexpr size_t LaneCapacity = 1024;
+
+    /* Bounded deque; owner uses the back, thieves take the front */
+    struct Lane
+    {
+        std::mutex m_lock;
+        Task m_tasks[LaneCapacity];
+        size_t m_front = 0;
+        size_t m_count = 0;
+        bool pushBack(const Task& task);
+        bool popBack(Task& task);
+        bool popFront(Task& task);
+    };
+
+    struct Worker
+    {
+        TaskScheduler* m_parent;
+        size_t m_index;
+        Lane m_lanes[PriorityCount];
+        std::thread m_thread;
+        Worker(TaskScheduler* parent, size_t index) : m_parent(parent), m_index(index) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Lane m_injection[PriorityCount];
+    ThreadLocalPtr<Worker> m_currentWorker;
+
+    std::atomic_size_t m_queued = {0};
+    std::atomic_size_t m_sleepers = {0};
+    std::atomic_bool m_running = {true};
+    std::mutex m_sleepLock;
+    std::condition_variable m_sleepCv;
+    std::mutex m_waitLock;
+    std::condition_variable m_waitCv;
+
+    void _workerProc(Worker* worker);
+    bool _findTask(Worker* self, Task& task, size_t lowestLane=PriorityCount-1);
+    bool _runOne(size_t lowestLane=PriorityCount-1);
+    void _execute(const Task& task);
+
+    template <class F>
+    struct ParallelForCtx
+    {
+        F* m_func;
+        size_t m_count;
+        size_t m_grain;
+        std::atomic_size_t m_next = {0};
+        static void Run(void* ctx)
+        {
+            ParallelForCtx& c = *static_cast<ParallelForCtx*>(ctx);
+            for (size_t begin = c.m_next.fetch_add(c.m_grain) ; begin < c.m_count ;
+                 begin = c.m_next.fetch_add(c.m_grain))
+                (*c.m_func)(begin, std::min(begin + c.m_grain, c.m_count));
+        }
+    };
+
+public:
+    /** workerCount of 0 creates one worker per hardware thread */
+    explicit TaskScheduler(size_t workerCount=0);
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /** Process-wide instance shared by boo subsystems and clients */
+    static TaskScheduler& Shared();
+
+    size_t getWorkerCount() const {return m_workers.size();}
+
+    /** Queue func(ctx); allocation-free */
+    void submit(TaskFunc func, void* ctx, TaskPriority prio=TaskPriority::Normal,
+                TaskGroup* group=nullptr);
+
+    /** Queue an arbitrary callable (heap-allocates a copy; not for the audio thread) */
+    template <class F>
+    void submit(F&& func, TaskPriority prio=TaskPriority::Normal, TaskGroup* group=nullptr)
+    {
+        using Fn = typename std::decay<F>::type;
+        submit([](void* ctx)
+        {
+            std::unique_ptr<Fn> fn(static_cast<Fn*>(ctx));
+            (*fn)();
+        }, new Fn(std::forward<F>(func)), prio, group);
+    }
+
+    /** Block until group completes. Meanwhile the caller runs queued tasks no lower
+     *  in priority than the group's own, and sleeps when none are available */
+    void wait(TaskGroup& group);
+
+    /** Invoke func(begin, end) over [0, count) in grain-sized ranges; the calling
+     *  thread participates and returns once every range has run. Allocation-free */
+    template <class F>
+    void parallelFor(size_t count, size_t grain, F&& func, TaskPriority prio=TaskPriority::Normal)
+    {
+        if (!count)
+            return;
+        grain = std::max(grain, size_t(1));
+        size_t ranges = (count + grain - 1) / grain;
+        ParallelForCtx<typename std::remove_reference<F>::type> ctx;
+        ctx.m_func = &func;
+        ctx.m_count = count;
+        ctx.m_grain = grain;
+        TaskGroup group;
+        size_t helpers = std::min(ranges - 1, m_workers.size());
+        for (size_t i=0 ; i<helpers ; ++i)
+            submit(&decltype(ctx)::Run, &ctx, prio, &group);
+        decltype(ctx)::Run(&ctx);
+        wait(group);
+    }
+};
+
+}
+
+#endif // BOO_TASKSCHEDULER_HPP
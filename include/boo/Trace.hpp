@@ -0,0 +1,87 @@
+#ifndef BOO_TRACE_HPP
+#define BOO_TRACE_HPP
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#if __x86_64__ || __i386__
+#include <x86intrin.h>
+#elif _M_X64 || _M_IX86
+#include <intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace boo
+{
+namespace trace
+{
+
+extern std::atomic_bool g_enabled;
+
+/** Runtime switch; zones compiled in with BOO_TRACE cost one branch while disabled */
+static inline bool IsEnabled() {return g_enabled.load(std::memory_order_relaxed);}
+void SetEnabled(bool enabled);
+
+/** Raw timestamp (TSC where available); converted to microseconds on export */
+static inline uint64_t Now()
+{
+#if __x86_64__ || __i386__ || _M_X64 || _M_IX86
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/** Append a completed zone to the calling thread's ring buffer (lock-free).
+ *  name must have static storage duration */
+void Record(const char* name, uint64_t begin, uint64_t end);
+
+/** Label the calling thread in exported traces */
+void SetThreadName(const char* name);
+
+/** Discard all recorded zones */
+void Clear();
+
+/** Export recorded zones in Chrome trace-event JSON (loadable by chrome://tracing
+ *  and Perfetto). Zones recorded while exporting may be omitted */
+std::string GetChromeJSON();
+bool WriteChromeJSON(const char* path);
+
+/** RAII zone; prefer the BOO_TRACE_ZONE macro so builds without BOO_TRACE drop it */
+class Zone
+{
+    const char* m_name;
+    uint64_t m_begin = 0;
+    bool m_active;
+public:
+    explicit Zone(const char* name) : m_name(name), m_active(IsEnabled())
+    {
+        if (m_active)
+            m_begin = Now();
+    }
+    ~Zone()
+    {
+        if (m_active)
+            Record(m_name, m_begin, Now());
+    }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+};
+
+}
+}
+
+#define BOO_TRACE_CAT2(a, b) a##b
+#define BOO_TRACE_CAT(a, b) BOO_TRACE_CAT2(a, b)
+
+#if BOO_TRACE
+#define BOO_TRACE_ZONE(name) ::boo::trace::Zone BOO_TRACE_CAT(_booTraceZone, __LINE__)(name)
+#define BOO_TRACE_THREAD_NAME(name) ::boo::trace::SetThreadName(name)
+#else
+#define BOO_TRACE_ZONE(name) ((void)0)
+#define BOO_TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif // BOO_TRACE_HPP
@@ -0,0 +1,42 @@
+#ifndef BOO_AUDIOSPATIALIZER_HPP
+#define BOO_AUDIOSPATIALIZER_HPP
+
+#include "IAudioVoice.hpp"
+
+namespace boo
+{
+
+/** Listener transform; basis vectors must be orthonormal */
+struct SpatialListener
+{
+    float m_position[3] = {0.f, 0.f, 0.f};
+    float m_right[3] = {1.f, 0.f, 0.f};
+    float m_up[3] = {0.f, 1.f, 0.f};
+    float m_front[3] = {0.f, 0.f, 1.f};
+};
+
+/** Structure-of-arrays batch of point emitters, one voice each */
+struct SpatialEmitterBatch
+{
+    size_t m_count = 0;
+    const float* m_x = nullptr; /* World-space positions */
+    const float* m_y = nullptr;
+    const float* m_z = nullptr;
+    const float* m_gains = nullptr; /* Optional per-emitter linear gain */
+    IAudioVoice* const* m_voices = nullptr;
+    IAudioSubmix* m_submix = nullptr; /* nullptr targets the main mix */
+    float m_minDistance = 1.f; /* Inverse-distance rolloff clamped to [min, max] */
+    float m_maxDistance = 1000.f;
+    bool m_slew = true;
+};
+
+/** Compute constant-power panning gains (pairwise VBAP over the horizontal speaker ring,
+ *  sine-law for stereo) with distance attenuation for count emitters. Emitters directly
+ *  above/below the listener spread evenly across all speakers. coefsOut is indexed by
+ *  AudioChannel, matching IAudioVoice::setMonoChannelLevels */
+void ComputeSpatialGains(AudioChannelSet set, const SpatialListener& listener,
+                         const SpatialEmitterBatch& batch, float (*coefsOut)[8]);
+
+}
+
+#endif // BOO_AUDIOSPATIALIZER_HPP
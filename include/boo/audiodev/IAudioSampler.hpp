@@ -0,0 +1,71 @@
+#ifndef BOO_IAUDIOSAMPLER_HPP
+#define BOO_IAUDIOSAMPLER_HPP
+
+#include "IAudioVoice.hpp"
+#include "IMIDIReader.hpp"
+
+namespace boo
+{
+
+/** Amplitude envelope; times in seconds, sustain as linear level */
+struct SamplerEnvelope
+{
+    float m_attack = 0.002f;
+    float m_decay = 0.f;
+    float m_sustain = 1.f;
+    float m_release = 0.05f;
+};
+
+/** PCM sample mapped across a key/velocity range */
+struct SamplerZone
+{
+    const int16_t* m_samples = nullptr; /* Client-owned; must outlive the sampler */
+    size_t m_frames = 0;
+    unsigned m_channels = 1; /* 1, or 2 for interleaved stereo */
+    double m_sampleRate = 32000.0;
+    uint8_t m_rootKey = 60;
+    uint8_t m_keyLo = 0;
+    uint8_t m_keyHi = 127;
+    uint8_t m_velLo = 1;
+    uint8_t m_velHi = 127;
+    uint8_t m_channel = 0xff; /* 0xff matches every MIDI channel */
+    size_t m_loopStart = 0;
+    size_t m_loopEnd = 0; /* 0 disables looping */
+    float m_gain = 1.f;
+    int m_priority = 0;
+    SamplerEnvelope m_envelope;
+};
+
+enum class SamplerStealMode
+{
+    Oldest,  /* Steal released voices first, then the oldest sounding voice */
+    Priority /* Steal the lowest-priority zone's voice; notes below every sounding priority are dropped */
+};
+
+/** Polyphonic sampler driven directly by MIDI events (e.g. from MIDIDecoder or a MIDISequence).
+ *  All note slots are preallocated and rendered at the output rate inside the mix, so note-on
+ *  never allocates or designs a resampling filter. MIDI callbacks may arrive from any thread;
+ *  they are queued and applied at the start of the next mix block */
+struct IAudioSampler : IMIDIReader
+{
+    virtual ~IAudioSampler() = default;
+
+    /** Voice carrying the sampler's stereo output; use for channel levels and start/stop */
+    virtual IAudioVoice& voice()=0;
+
+    /** Configure zones while the sampler voice is stopped */
+    virtual void addZone(const SamplerZone& zone)=0;
+    virtual void clearZones()=0;
+
+    virtual void setStealMode(SamplerStealMode mode)=0;
+
+    /** Range of full pitch-bend deflection in semitones (default 2) */
+    virtual void setPitchBendRange(float semitones)=0;
+
+    /** Count of slots sounding as of the last mixed block */
+    virtual size_t getActiveVoiceCount() const=0;
+};
+
+}
+
+#endif // BOO_IAUDIOSAMPLER_HPP
@@ -81,6 +81,9 @@ struct IAudioVoice
 
     /** Invalidates this voice by removing it from the AudioVoiceEngine */
     virtual void unbindVoice()=0;
+
+    /** Name of the resampling kernel in use (e.g. "single-precision-SIMD"); for diagnostics */
+    virtual const char* getResamplerEngine() const=0;
 };
 
 struct IAudioVoiceCallback
@@ -3,6 +3,7 @@
 
 #include "IAudioVoice.hpp"
 #include "IAudioSubmix.hpp"
+#include "IAudioSampler.hpp"
 #include "IMIDIPort.hpp"
 #include <memory>
 #include <vector>
@@ -10,6 +11,33 @@
 namespace boo
 {
 struct IAudioVoiceEngine;
+class IMIDIReader;
+class MIDISequence;
+struct SpatialListener;
+struct SpatialEmitterBatch;
+
+/** Runtime tuning for voice resamplers (soxr); applies to voices created or
+ *  sample-rate-reset after it is set */
+struct AudioResamplerConfig
+{
+    enum class CoefInterpolation
+    {
+        Auto, /* Selected from m_coefSizeKBytes */
+        Low,  /* Less CPU, more memory */
+        High  /* More CPU, less memory */
+    };
+    CoefInterpolation m_coefInterp = CoefInterpolation::Auto;
+    unsigned m_coefSizeKBytes = 400;
+    unsigned m_log2MinDFTSize = 10;
+    unsigned m_log2LargeDFTSize = 17;
+
+    /* Per-channel worker threads when soxr is built with OpenMP; 0 is automatic */
+    unsigned m_threads = 1;
+
+    /* Allow the SIMD fixed-rate kernel where build and CPU support it
+     * (dynamic-pitch voices use whichever variable-rate kernel was built) */
+    bool m_useSIMD = true;
+};
 
 /** Time-sensitive event callback for synchronizing the client with rendered audio waveform */
 struct IAudioVoiceEngineCallback
@@ -18,6 +46,10 @@ struct IAudioVoiceEngineCallback
      *  this is called at the start of each interval for all mixable entities */
     virtual void on5MsInterval(IAudioVoiceEngine& engine, double dt) {}
 
+    /** Called at the start of each mix quantum with its length in output frames
+     *  (see IAudioVoiceEngine::setMixQuantumFrames); defaults to on5MsInterval */
+    virtual void onMixQuantum(IAudioVoiceEngine& engine, size_t frames, double dt) { on5MsInterval(engine, dt); }
+
     /** When a pumping cycle is complete this is called to allow the client to
      *  perform periodic cleanup tasks */
     virtual void onPumpCycleComplete(IAudioVoiceEngine& engine) {}
@@ -48,6 +80,11 @@ struct IAudioVoiceEngine
     /** Client calls this to allocate a Submix for gathering audio together for effects processing */
     virtual std::unique_ptr<IAudioSubmix> allocateNewSubmix(bool mainOut, IAudioSubmixCallback* cb, int busId)=0;
 
+    /** Client calls this to allocate a MIDI-driven sampler with a fixed count of note slots.
+     *  The optional callback receives preSupplyAudio/routeAudio like any other voice;
+     *  start the sampler's voice() before sending notes */
+    virtual std::unique_ptr<IAudioSampler> allocateNewSampler(size_t polyphony, IAudioVoiceCallback* cb=nullptr)=0;
+
     /** Client can register for key callback events from the mixing engine this way */
     virtual void setCallbackInterface(IAudioVoiceEngineCallback* cb)=0;
 
@@ -87,6 +124,51 @@ struct IAudioVoiceEngine
     /** Get canonical count of frames for each 5ms output block */
     virtual size_t get5MsFrames() const=0;
 
+    /** Set count of frames mixed per block (slews and mix-quantum callbacks follow this);
+     *  0 restores the default 5ms block. Call from the thread that pumps the engine */
+    virtual void setMixQuantumFrames(size_t frames)=0;
+
+    /** Get count of frames currently mixed per block */
+    virtual size_t getMixQuantumFrames() const=0;
+
+    /** Set resampler tuning for subsequently created voices */
+    virtual void setResamplerConfig(const AudioResamplerConfig& config)=0;
+
+    /** Get current resampler tuning */
+    virtual const AudioResamplerConfig& getResamplerConfig() const=0;
+
+    /** Get count of output frames mixed since engine creation; timebase for scheduled voice events */
+    virtual uint64_t getFrameClock() const=0;
+
+    /** Start voice exactly at the given output frame (see getFrameClock) */
+    virtual void scheduleStart(IAudioVoice* voice, uint64_t frame)=0;
+
+    /** Stop voice exactly at the given output frame */
+    virtual void scheduleStop(IAudioVoice* voice, uint64_t frame)=0;
+
+    /** Set pitch ratio of dynamic-pitch voice exactly at the given output frame */
+    virtual void schedulePitchRatio(IAudioVoice* voice, uint64_t frame, double ratio)=0;
+
+    /** Set mono channel-levels of voice exactly at the given output frame */
+    virtual void scheduleMonoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                           IAudioSubmix* submix, const float coefs[8])=0;
+
+    /** Set stereo channel-levels of voice exactly at the given output frame */
+    virtual void scheduleStereoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                             IAudioSubmix* submix, const float coefs[8][2])=0;
+
+    /** Play precompiled MIDI sequence into reader beginning at the given output frame;
+     *  events are dispatched from within the mix loop at their exact frame */
+    virtual void playMIDISequence(const std::shared_ptr<MIDISequence>& seq,
+                                  IMIDIReader* reader, uint64_t startFrame)=0;
+
+    /** Stop all sequences playing into reader */
+    virtual void stopMIDISequences(IMIDIReader* reader)=0;
+
+    /** Pan and attenuate a batch of emitters for the active channel set (see AudioSpatializer.hpp)
+     *  and apply the result as each voice's mono channel-levels */
+    virtual void spatializeEmitters(const SpatialListener& listener, const SpatialEmitterBatch& batch)=0;
+
     /** IWindow::waitForRetrace() enter - for platforms that spend v-sync waits synchronously pumping audio */
     virtual void _pumpAndMixVoicesRetrace() { pumpAndMixVoices(); }
 
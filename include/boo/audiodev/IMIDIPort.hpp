@@ -1,15 +1,67 @@
 #ifndef BOO_IMIDIPORT_HPP
 #define BOO_IMIDIPORT_HPP
 
+#include "MIDIEventRing.hpp"
 #include <string>
 #include <functional>
+#include <type_traits>
 #include <vector>
 #include <stdint.h>
 
 namespace boo
 {
 
-using ReceiveFunctor = std::function<void(std::vector<uint8_t>&&, double time)>;
+/** Receives each MIDI packet as an owned byte vector (allocates once per packet) */
+using VectorReceiveFunctor = std::function<void(std::vector<uint8_t>&&, double time)>;
+
+/** Receives each MIDI packet as a borrowed byte range, valid only for the duration of the call */
+using SpanReceiveFunctor = std::function<void(const uint8_t* data, size_t len, double time)>;
+
+/** Destination of a MIDI in port's received bytes; constructible from either
+ *  callback form or a client-owned MIDIEventRing. The ring and span forms
+ *  never allocate on the receive thread */
+class ReceiveFunctor
+{
+    VectorReceiveFunctor m_vecFunc;
+    SpanReceiveFunctor m_spanFunc;
+    MIDIEventRing* m_ring = nullptr;
+public:
+    ReceiveFunctor() = default;
+    ReceiveFunctor(MIDIEventRing& ring) : m_ring(&ring) {}
+
+    /* Anything callable with the vector form takes it, so callables that fit
+     * both signatures (e.g. variadic generic lambdas) keep their old behavior */
+    template <class Func,
+              typename std::enable_if<std::is_constructible<VectorReceiveFunctor, Func>::value &&
+                                      !std::is_same<typename std::decay<Func>::type, ReceiveFunctor>::value,
+                                      int>::type = 0>
+    ReceiveFunctor(Func&& func) : m_vecFunc(std::forward<Func>(func)) {}
+
+    template <class Func,
+              typename std::enable_if<std::is_constructible<SpanReceiveFunctor, Func>::value &&
+                                      !std::is_constructible<VectorReceiveFunctor, Func>::value, int>::type = 0>
+    ReceiveFunctor(Func&& func) : m_spanFunc(std::forward<Func>(func)) {}
+
+    void operator()(const uint8_t* data, size_t len, double time) const
+    {
+        if (m_ring)
+            m_ring->push(data, len, time);
+        else if (m_spanFunc)
+            m_spanFunc(data, len, time);
+        else if (m_vecFunc)
+            m_vecFunc(std::vector<uint8_t>(data, data + len), time);
+    }
+
+    void operator()(std::vector<uint8_t>&& bytes, double time) const
+    {
+        if (m_vecFunc)
+            m_vecFunc(std::move(bytes), time);
+        else
+            (*this)(bytes.data(), bytes.size(), time);
+    }
+
+    explicit operator bool() const {return m_ring || m_spanFunc || m_vecFunc;}
+};
 
 class IMIDIPort
 {
@@ -26,6 +26,15 @@ public:
     virtual void polyMode(uint8_t chan, bool on)=0;
 
     virtual void sysex(const void* data, size_t len)=0;
+
+    /** Readers returning true receive SysEx payloads piecewise via sysexChunk()
+     *  instead of one buffered sysex() call per message */
+    virtual bool streamsSysEx() const {return false;}
+    virtual void sysexChunk(const void* data, size_t len, bool first, bool last) {}
+
+    /** Standard MIDI File meta event (type byte followed by payload) */
+    virtual void metaEvent(uint8_t type, const void* data, size_t len) {}
+
     virtual void timeCodeQuarterFrame(uint8_t message, uint8_t value)=0;
     virtual void songPositionPointer(uint16_t pointer)=0;
     virtual void songSelect(uint8_t song)=0;
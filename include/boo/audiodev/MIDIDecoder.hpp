@@ -13,14 +13,30 @@ class MIDIDecoder
 {
     IMIDIReader& m_out;
     uint8_t m_status = 0;
+
+    /* Streaming state carried between receiveBytes() calls */
+    uint8_t m_data[2];
+    uint8_t m_dataCount = 0;
+    bool m_inSysEx = false;
+    bool m_sysExFirst = false;
+    std::vector<uint8_t> m_sysExBuf;
+
+    void _sysExData(const uint8_t* data, size_t len, bool last);
     bool _readContinuedValue(std::vector<uint8_t>::const_iterator& it,
                              std::vector<uint8_t>::const_iterator end,
                              uint32_t& valOut);
 public:
     MIDIDecoder(IMIDIReader& out) : m_out(out) {}
+
+    /** Decode one message (Standard MIDI File event syntax: length-prefixed SysEx, meta events).
+     *  Returns iterator past the message, or begin if the message is incomplete */
     std::vector<uint8_t>::const_iterator
     receiveBytes(std::vector<uint8_t>::const_iterator begin,
                  std::vector<uint8_t>::const_iterator end);
+
+    /** Decode every message in a raw MIDI wire stream. Running status and partially-received
+     *  messages carry over to the next call; SysEx is forwarded as it arrives */
+    void receiveBytes(const uint8_t* data, size_t len);
 };
 
 }
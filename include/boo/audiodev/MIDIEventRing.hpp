@@ -0,0 +1,103 @@
+#ifndef BOO_MIDIEVENTRING_HPP
+#define BOO_MIDIEVENTRING_HPP
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace boo
+{
+
+/** Timestamped chunk of raw MIDI bytes as delivered by a MIDI in port.
+ *  Chunks are not guaranteed to hold whole messages; feed them through a
+ *  MIDIDecoder which keeps running status across calls */
+struct MIDIEventRecord
+{
+    static constexpr size_t MaxBytes = 52;
+    double m_time;
+    uint32_t m_len;
+    uint8_t m_data[MaxBytes];
+};
+
+/** Preallocated single-producer/single-consumer ring of MIDIEventRecords.
+ *  The port's receive thread pushes without locking or allocating;
+ *  the client drains on its own schedule (e.g. once per mix quantum) */
+class MIDIEventRing
+{
+    std::unique_ptr<MIDIEventRecord[]> m_records;
+    size_t m_mask;
+    std::atomic<size_t> m_writeIdx = {0};
+    std::atomic<size_t> m_readIdx = {0};
+    std::atomic<size_t> m_droppedPackets = {0};
+
+public:
+    /** Capacity is rounded up to a power-of-two count of records */
+    explicit MIDIEventRing(size_t capacity=512)
+    {
+        size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        m_records.reset(new MIDIEventRecord[cap]);
+        m_mask = cap - 1;
+    }
+
+    /** Producer side; packets longer than MaxBytes span consecutive records.
+     *  Returns false (and counts a dropped packet) if the ring is full */
+    bool push(const uint8_t* data, size_t len, double time)
+    {
+        size_t recCount = (len + MIDIEventRecord::MaxBytes - 1) / MIDIEventRecord::MaxBytes;
+        size_t w = m_writeIdx.load(std::memory_order_relaxed);
+        size_t r = m_readIdx.load(std::memory_order_acquire);
+        if (m_mask + 1 - (w - r) < recCount)
+        {
+            m_droppedPackets.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        while (len)
+        {
+            MIDIEventRecord& rec = m_records[w & m_mask];
+            size_t thisLen = len < MIDIEventRecord::MaxBytes ? len : MIDIEventRecord::MaxBytes;
+            rec.m_time = time;
+            rec.m_len = uint32_t(thisLen);
+            memmove(rec.m_data, data, thisLen);
+            data += thisLen;
+            len -= thisLen;
+            ++w;
+        }
+
+        m_writeIdx.store(w, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side; invokes func(const uint8_t* data, size_t len, double time)
+     *  for every pending record in arrival order. Returns count of records drained */
+    template <class Func>
+    size_t drain(Func&& func)
+    {
+        size_t r = m_readIdx.load(std::memory_order_relaxed);
+        size_t w = m_writeIdx.load(std::memory_order_acquire);
+        size_t count = w - r;
+        for (; r != w ; ++r)
+        {
+            const MIDIEventRecord& rec = m_records[r & m_mask];
+            func(rec.m_data, size_t(rec.m_len), rec.m_time);
+        }
+        m_readIdx.store(r, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const
+    {
+        return m_readIdx.load(std::memory_order_relaxed) == m_writeIdx.load(std::memory_order_acquire);
+    }
+
+    /** Count of packets discarded because the consumer fell behind */
+    size_t droppedPackets() const {return m_droppedPackets.load(std::memory_order_relaxed);}
+};
+
+}
+
+#endif // BOO_MIDIEVENTRING_HPP
@@ -0,0 +1,83 @@
+#ifndef BOO_MIDIOUTQUEUE_HPP
+#define BOO_MIDIOUTQUEUE_HPP
+
+#include "boo/audiodev/IMIDIPort.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace boo
+{
+
+/** Buffered, timestamp-scheduled front-end for a MIDI out port.
+ *  Usable as the Sender of a MIDIEncoder: sends only enqueue, and a dedicated
+ *  thread writes every due message in one coalesced port write, re-applying
+ *  running status across the batch */
+class MIDIOutQueue
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Message
+    {
+        Clock::time_point m_time;
+        uint32_t m_offset;
+        uint32_t m_len;
+    };
+
+    std::function<size_t(const void*, size_t)> m_sink;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    bool m_running = true;
+    bool m_wakePending = false;
+    unsigned m_batchDepth = 0;
+
+    /* Complete messages in time order; bytes live in m_bytes */
+    std::vector<Message> m_messages;
+    std::vector<uint8_t> m_bytes;
+    std::vector<uint8_t> m_spareBytes;
+
+    /* Input-side parse state (reconstructs whole messages from running-status input) */
+    Clock::time_point m_sendTime;
+    std::vector<uint8_t> m_partial;
+    uint8_t m_inStatus = 0;
+    bool m_inSysEx = false;
+
+    /* Output-side running status; only touched by the output thread */
+    uint8_t m_outStatus = 0;
+    std::vector<uint8_t> m_writeBuf;
+
+    std::thread m_thread;
+
+    void _enqueue(const uint8_t* data, size_t len, Clock::time_point time);
+    void _finishMessage(const uint8_t* data, size_t len, Clock::time_point time);
+    void _finishPartial(Clock::time_point time);
+    void _wakeIfNeeded();
+    void _flushDue(std::unique_lock<std::mutex>& lk, bool all);
+    void _proc();
+
+public:
+    MIDIOutQueue(IMIDIOut& out);
+    MIDIOutQueue(IMIDIInOut& out);
+    ~MIDIOutQueue();
+
+    /** Timestamp applied to subsequent send() calls; a default (or past) time sends immediately */
+    void setSendTime(Clock::time_point time);
+
+    /** Enqueue raw MIDI bytes (running status permitted) at the current send time */
+    size_t send(const void* buf, size_t len);
+
+    /** Enqueue raw MIDI bytes for transmission at the given time */
+    void sendAt(Clock::time_point time, const void* buf, size_t len);
+
+    /** Hold the output thread between beginBatch() and endBatch() so that
+     *  immediate messages sent in between go out as a single write */
+    void beginBatch();
+    void endBatch();
+};
+
+}
+
+#endif // BOO_MIDIOUTQUEUE_HPP
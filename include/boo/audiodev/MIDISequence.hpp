@@ -0,0 +1,49 @@
+#ifndef BOO_MIDISEQUENCE_HPP
+#define BOO_MIDISEQUENCE_HPP
+
+#include "boo/audiodev/IMIDIReader.hpp"
+#include <memory>
+#include <vector>
+
+namespace boo
+{
+
+/** Standard MIDI File (type 0/1) precompiled into a single time-sorted event array.
+ *  All tracks are merged and tempo changes are resolved at load, so playback is a
+ *  cursor walk over m_events with no per-block parsing */
+class MIDISequence
+{
+public:
+    struct Event
+    {
+        double m_time; /* Seconds from sequence start */
+        uint32_t m_payloadOffset; /* SysEx / meta payload within m_payload */
+        uint32_t m_payloadLen;
+        uint8_t m_status; /* 0xF0 for SysEx, 0xFF for meta */
+        uint8_t m_data[2]; /* Channel data bytes; meta type in m_data[0] */
+    };
+
+private:
+    std::vector<Event> m_events;
+    std::vector<uint8_t> m_payload;
+    double m_duration = 0.0;
+    bool m_valid = false;
+
+public:
+    /** Parse SMF image from memory; check isValid() afterwards */
+    MIDISequence(const uint8_t* data, size_t len);
+
+    /** Memory-map and parse SMF from disk; returns empty pointer on failure */
+    static std::shared_ptr<MIDISequence> LoadFile(const char* path);
+
+    bool isValid() const {return m_valid;}
+    double duration() const {return m_duration;}
+    const std::vector<Event>& events() const {return m_events;}
+
+    /** Deliver a single event to reader */
+    void dispatch(const Event& ev, IMIDIReader& reader) const;
+};
+
+}
+
+#endif // BOO_MIDISEQUENCE_HPP
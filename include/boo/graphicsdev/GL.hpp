@@ -12,6 +12,16 @@ namespace boo
 class GLDataFactory : public IGraphicsDataFactory
 {
 public:
+    /** Reuse linked programs across launches through an on-disk cache of program
+     *  binaries at path, replacing compile and link on hits. The whole cache is
+     *  discarded when the GL vendor, renderer or version changes. Call from a thread
+     *  with a current context before creating pipelines; false if unsupported */
+    virtual bool setProgramBinaryCachePath(const char* path)=0;
+
+    /** Write programs linked since the cache was loaded (also done on destruction).
+     *  Call from a thread with a current context so pending binaries can be read back */
+    virtual bool saveProgramBinaryCache()=0;
+
     class Context : public IGraphicsDataFactory::Context
     {
         friend class GLDataFactoryImpl;
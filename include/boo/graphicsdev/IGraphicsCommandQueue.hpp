@@ -8,6 +8,26 @@
 namespace boo
 {
 
+/** Tightly packed records of a BufferUse::Indirect buffer for drawIndirect()
+ *  (layout matches GL DrawArraysIndirectCommand and VkDrawIndirectCommand) */
+struct DrawIndirectCommand
+{
+    uint32_t vertexCount;
+    uint32_t instanceCount;
+    uint32_t firstVertex;
+    uint32_t firstInstance;
+};
+
+/** Records for drawIndexedIndirect() (DrawElementsIndirectCommand / VkDrawIndexedIndirectCommand) */
+struct DrawIndexedIndirectCommand
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+};
+
 struct IGraphicsCommandQueue
 {
     virtual ~IGraphicsCommandQueue() = default;
@@ -17,6 +37,27 @@ struct IGraphicsCommandQueue
     virtual const SystemChar* platformName() const=0;
 
     virtual void setShaderDataBinding(IShaderDataBinding* binding)=0;
+
+    /** Frame-lifetime uniform block sub-allocated from the queue's ring */
+    struct TransientUniform
+    {
+        void* data = nullptr; /**< Write-only pointer, valid until execute(); null when exhausted */
+        size_t offset = 0;    /**< Dynamic offset for setShaderDataBindingDynamic() */
+    };
+
+    /** Ring backing allocTransientUniform(); shader data bindings reference it like any
+     *  uniform buffer (ubufSizes must be provided) and receive offsets per draw */
+    virtual IGraphicsBufferD* getTransientUniformBuffer() {return nullptr;}
+
+    /** Sub-allocate size bytes aligned to the device's uniform offset alignment.
+     *  Replaces per-object uniform buffers for data rewritten every frame */
+    virtual TransientUniform allocTransientUniform(size_t size) {return {};}
+
+    /** Bind with per-draw offsets; dynOffsets[i] is added to uniform slot i when
+     *  that slot references the transient ring and is ignored otherwise */
+    virtual void setShaderDataBindingDynamic(IShaderDataBinding* binding,
+                                             const size_t* dynOffsets, size_t dynOffsetCount)
+    {setShaderDataBinding(binding);}
     virtual void setRenderTarget(ITextureR* target)=0;
     virtual void setViewport(const SWindowRect& rect, float znear=0.f, float zfar=1.f)=0;
     virtual void setScissor(const SWindowRect& rect)=0;
@@ -32,6 +73,27 @@ struct IGraphicsCommandQueue
     virtual void drawInstances(size_t start, size_t count, size_t instCount)=0;
     virtual void drawInstancesIndexed(size_t start, size_t count, size_t instCount)=0;
 
+    /** Whether drawIndirect()/drawIndexedIndirect() are available; backends
+     *  without them report an error and drop the draw */
+    virtual bool supportsDrawIndirect() const {return false;}
+
+    /** Whether drawIndirectCount()/drawIndexedIndirectCount() are available */
+    virtual bool supportsDrawIndirectCount() const {return false;}
+
+    /** Issue drawCount draws with the bound shader data, reading their parameters from
+     *  a BufferUse::Indirect buffer at byte offset (which must be a multiple of 4).
+     *  Arguments may be written by the CPU or by GPU-side culling */
+    virtual void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)=0;
+    virtual void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)=0;
+
+    /** As above, but the draw count is a uint32_t read from countBuf at countOffset
+     *  (clamped to maxDrawCount), so GPU culling can also decide how many draws run.
+     *  countBuf must also be a BufferUse::Indirect buffer */
+    virtual void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                   IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)=0;
+    virtual void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                          IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)=0;
+
     virtual void resolveBindTexture(ITextureR* texture, const SWindowRect& rect, bool tlOrigin, bool color, bool depth)=0;
     virtual void resolveDisplay(ITextureR* source)=0;
     virtual void execute()=0;
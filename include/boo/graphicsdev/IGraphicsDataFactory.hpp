@@ -43,7 +43,8 @@ enum class BufferUse
     Null,
     Vertex,
     Index,
-    Uniform
+    Uniform,
+    Indirect
 };
 
 enum class TextureType
@@ -83,6 +84,11 @@ struct ITextureD : ITexture
     virtual void load(const void* data, size_t sz)=0;
     virtual void* map(size_t sz)=0;
     virtual void unmap()=0;
+
+    /** Replace the w x h texel rectangle at (x, y); rows of data are pitch bytes
+     *  apart (0 for tightly packed). Backends re-upload only the touched region
+     *  where they can */
+    virtual void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)=0;
 protected:
     ITextureD() : ITexture(TextureType::Dynamic) {}
 };
@@ -141,7 +147,14 @@ struct VertexElementDescriptor
 
 /** Opaque token for referencing a complete graphics pipeline state necessary
  *  to rasterize geometry (shaders and blending modes mainly) */
-struct IShaderPipeline {};
+struct IShaderPipeline
+{
+    /** Backends that compile asynchronously report false until the pipeline has
+     *  finished linking, so callers may draw a fallback instead of stalling.
+     *  Draws made with a pipeline that is not ready are skipped.
+     *  A pipeline that failed to build never becomes ready */
+    virtual bool isReady() const {return true;}
+};
 
 /** Opaque token serving as indirection table for shader resources
  *  and IShaderPipeline reference. Each renderable surface-material holds one
@@ -269,6 +282,8 @@ private:
     friend class GraphicsDataToken;
     virtual void destroyData(IGraphicsData*)=0;
     virtual void destroyAllData()=0;
+    virtual bool isDataReady(IGraphicsData*) {return true;}
+    virtual void waitData(IGraphicsData*) {}
 
     friend class GraphicsBufferPoolToken;
     virtual void destroyPool(IGraphicsBufferPool*)=0;
@@ -324,6 +339,17 @@ public:
     }
     ~GraphicsDataToken() {doDestroy();}
     operator bool() const {return m_factory && m_data;}
+
+    /** Non-blocking check that the GPU has finished this transaction's uploads.
+     *  Resources may be drawn before then; this only reports completion */
+    bool isReady() const {return !m_factory || !m_data || m_factory->isDataReady(m_data);}
+
+    /** Block until the GPU has finished this transaction's uploads */
+    void wait() const
+    {
+        if (m_factory && m_data)
+            m_factory->waitData(m_data);
+    }
 };
 
 /** Ownership token for maintaining lifetimes of an appendable list of dynamic buffers.
@@ -32,6 +32,8 @@ struct VulkanContext
     std::vector<VkPhysicalDevice> m_gpus;
     VkPhysicalDeviceProperties m_gpuProps;
     VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    VkPhysicalDeviceFeatures m_enabledFeatures = {};
+    bool m_drawIndirectCount = false; /* VK_KHR_draw_indirect_count enabled */
     VkDevice m_dev;
     uint32_t m_queueCount;
     uint32_t m_graphicsQueueFamilyIndex = UINT32_MAX;
@@ -41,8 +43,27 @@ struct VulkanContext
     VkDescriptorSetLayout m_descSetLayout;
     VkPipelineLayout m_pipelinelayout;
     VkRenderPass m_pass;
-    VkCommandPool m_loadPool;
-    VkCommandBuffer m_loadCmdBuf;
+
+    /* Each thread committing transactions records uploads into its own pool.
+     * Submitted buffers stay in flight with their data until its upload fence
+     * signals, then return to the free list for the next transaction.
+     * The render thread also retires them (under m_retireLock) so idle or
+     * exited loader threads don't pin their data; only the owning thread
+     * touches m_pool and m_cmdBuf */
+    struct LoadContext
+    {
+        VkCommandPool m_pool = VK_NULL_HANDLE;
+        VkCommandBuffer m_cmdBuf = VK_NULL_HANDLE;
+        std::mutex m_retireLock;
+        std::vector<std::pair<VkCommandBuffer, struct VulkanData*>> m_inFlight;
+        std::vector<VkCommandBuffer> m_freeCmdBufs;
+        void beginCmdBuf(VkDevice dev);
+    };
+    std::mutex m_loadCtxLock;
+    std::vector<std::unique_ptr<LoadContext>> m_loadCtxs;
+    ThreadLocalPtr<LoadContext> m_threadLoadCtx;
+    LoadContext& getLoadContext();
+
     VkSampler m_linearSampler;
     VkFormat m_displayFormat;
 
@@ -211,6 +211,12 @@ extern PFN_vkCreateWin32SurfaceKHR CreateWin32SurfaceKHR;
 extern PFN_vkGetPhysicalDeviceWin32PresentationSupportKHR GetPhysicalDeviceWin32PresentationSupportKHR;
 #endif
 
+#ifdef VK_KHR_draw_indirect_count
+// VK_KHR_draw_indirect_count
+extern PFN_vkCmdDrawIndirectCountKHR CmdDrawIndirectCountKHR;
+extern PFN_vkCmdDrawIndexedIndirectCountKHR CmdDrawIndexedIndirectCountKHR;
+#endif
+
 // VK_EXT_debug_report
 extern PFN_vkCreateDebugReportCallbackEXT CreateDebugReportCallbackEXT;
 extern PFN_vkDestroyDebugReportCallbackEXT DestroyDebugReportCallbackEXT;
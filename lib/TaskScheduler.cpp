@@ -0,0 +1,180 @@
+#include "boo/TaskScheduler.hpp"
+
+namespace boo
+{
+
+bool TaskScheduler::Lane::pushBack(const Task& task)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    if (m_count == LaneCapacity)
+        return false;
+    m_tasks[(m_front + m_count) % LaneCapacity] = task;
+    ++m_count;
+    return true;
+}
+
+bool TaskScheduler::Lane::popBack(Task& task)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    if (!m_count)
+        return false;
+    --m_count;
+    task = m_tasks[(m_front + m_count) % LaneCapacity];
+    return true;
+}
+
+bool TaskScheduler::Lane::popFront(Task& task)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    if (!m_count)
+        return false;
+    task = m_tasks[m_front];
+    m_front = (m_front + 1) % LaneCapacity;
+    --m_count;
+    return true;
+}
+
+TaskScheduler::TaskScheduler(size_t workerCount)
+{
+    if (!workerCount)
+        workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+    m_workers.reserve(workerCount);
+    for (size_t i=0 ; i<workerCount ; ++i)
+        m_workers.emplace_back(new Worker(this, i));
+    for (auto& w : m_workers)
+        w->m_thread = std::thread([this, worker = w.get()]() {_workerProc(worker);});
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::unique_lock<std::mutex> lk(m_sleepLock);
+        m_running = false;
+    }
+    m_sleepCv.notify_all();
+    for (auto& w : m_workers)
+        if (w->m_thread.joinable())
+            w->m_thread.join();
+
+    /* Drain anything submitted after the workers stopped */
+    while (_runOne()) {}
+}
+
+TaskScheduler& TaskScheduler::Shared()
+{
+    static TaskScheduler Instance;
+    return Instance;
+}
+
+void TaskScheduler::_execute(const Task& task)
+{
+    task.m_func(task.m_ctx);
+    if (task.m_group && task.m_group->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        /* The group may be destroyed once its waiter sees it done; touch only our own state */
+        std::unique_lock<std::mutex> lk(m_waitLock);
+        lk.unlock();
+        m_waitCv.notify_all();
+    }
+}
+
+bool TaskScheduler::_findTask(Worker* self, Task& task, size_t lowestLane)
+{
+    for (size_t p=0 ; p<=lowestLane ; ++p)
+    {
+        /* Own work newest-first for cache warmth */
+        if (self && self->m_lanes[p].popBack(task))
+            return true;
+
+        if (m_injection[p].popFront(task))
+            return true;
+
+        /* Steal oldest work from peers, starting after ourselves to spread contention */
+        size_t count = m_workers.size();
+        size_t start = self ? self->m_index + 1 : 0;
+        for (size_t i=0 ; i<count ; ++i)
+        {
+            Worker* victim = m_workers[(start + i) % count].get();
+            if (victim != self && victim->m_lanes[p].popFront(task))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::_runOne(size_t lowestLane)
+{
+    Task task;
+    if (!_findTask(m_currentWorker.get(), task, lowestLane))
+        return false;
+    --m_queued;
+    _execute(task);
+    return true;
+}
+
+void TaskScheduler::_workerProc(Worker* worker)
+{
+    m_currentWorker.reset(worker);
+    while (true)
+    {
+        if (_runOne())
+            continue;
+
+        std::unique_lock<std::mutex> lk(m_sleepLock);
+        if (!m_running)
+            break;
+        if (m_queued.load())
+            continue;
+        ++m_sleepers;
+        m_sleepCv.wait(lk, [this]() {return !m_running || m_queued.load();});
+        --m_sleepers;
+    }
+    m_currentWorker.reset();
+}
+
+void TaskScheduler::submit(TaskFunc func, void* ctx, TaskPriority prio, TaskGroup* group)
+{
+    Task task = {func, ctx, group};
+    if (group)
+    {
+        group->m_pending.fetch_add(1, std::memory_order_relaxed);
+        size_t lane = group->m_lowestLane.load(std::memory_order_relaxed);
+        while (lane < size_t(prio) &&
+               !group->m_lowestLane.compare_exchange_weak(lane, size_t(prio), std::memory_order_relaxed)) {}
+    }
+
+    Worker* self = m_currentWorker.get();
+    Lane& lane = self ? self->m_lanes[size_t(prio)] : m_injection[size_t(prio)];
+    ++m_queued;
+    if (!m_running || !lane.pushBack(task))
+    {
+        /* Lane full (or shutting down); degrade to synchronous execution */
+        --m_queued;
+        _execute(task);
+        return;
+    }
+
+    if (m_sleepers.load())
+    {
+        /* Lock pairs with the sleeper's predicate check so the wakeup can't be lost */
+        std::unique_lock<std::mutex> lk(m_sleepLock);
+        lk.unlock();
+        m_sleepCv.notify_one();
+    }
+}
+
+void TaskScheduler::wait(TaskGroup& group)
+{
+    size_t lowestLane = group.m_lowestLane.load(std::memory_order_relaxed);
+    while (!group.done())
+    {
+        if (_runOne(lowestLane))
+            continue;
+
+        /* Whatever remains of the group is running elsewhere; sleep until it completes */
+        std::unique_lock<std::mutex> lk(m_waitLock);
+        m_waitCv.wait(lk, [&]() {return group.done();});
+    }
+}
+
+}
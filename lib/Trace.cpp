@@ -0,0 +1,259 @@
+#include "boo/Trace.hpp"
+#include "boo/ThreadLocalPtr.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include "logvisor/logvisor.hpp"
+
+namespace boo
+{
+namespace trace
+{
+static logvisor::Module Log("boo::trace");
+
+std::atomic_bool g_enabled = {false};
+
+namespace
+{
+
+/* Fields are relaxed atomics so exporters may read slots the owner is rewriting;
+ * torn entries are detected against m_written and discarded */
+struct Event
+{
+    std::atomic<const char*> m_name;
+    std::atomic<uint64_t> m_begin;
+    std::atomic<uint64_t> m_end;
+};
+
+/* Single-producer ring; the owning thread writes, exporters only read */
+struct ThreadBuffer
+{
+    static constexpr size_t Capacity = 16384;
+    Event m_events[Capacity];
+    std::atomic<uint64_t> m_written = {0};
+    std::atomic<uint64_t> m_clearedAt = {0};
+    unsigned m_tid;
+    std::string m_name;
+};
+
+struct Registry
+{
+    std::mutex m_lock;
+    /* Buffers outlive their threads so late exports still see their zones,
+     * until a new thread takes over a buffer released on thread exit */
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::vector<ThreadBuffer*> m_freeBuffers;
+    unsigned m_nextTid = 0;
+    ThreadLocalPtr<ThreadBuffer> m_current;
+    uint64_t m_baseTicks = Now();
+    std::chrono::steady_clock::time_point m_baseTime = std::chrono::steady_clock::now();
+};
+
+Registry& GetRegistry()
+{
+    static Registry Reg;
+    return Reg;
+}
+
+/* Returns the calling thread's buffer to the registry when the thread exits */
+struct ThreadRelease
+{
+    ThreadBuffer* m_buf = nullptr;
+    ~ThreadRelease()
+    {
+        if (!m_buf)
+            return;
+        Registry& reg = GetRegistry();
+        std::unique_lock<std::mutex> lk(reg.m_lock);
+        reg.m_freeBuffers.push_back(m_buf);
+        reg.m_current.reset();
+    }
+};
+
+ThreadBuffer& GetThreadBuffer()
+{
+    Registry& reg = GetRegistry();
+    if (ThreadBuffer* buf = reg.m_current.get())
+        return *buf;
+
+    std::unique_lock<std::mutex> lk(reg.m_lock);
+    ThreadBuffer* buf;
+    if (reg.m_freeBuffers.size())
+    {
+        /* Reuse a dead thread's ring; its zones are dropped rather than misattributed */
+        buf = reg.m_freeBuffers.back();
+        reg.m_freeBuffers.pop_back();
+        buf->m_clearedAt.store(buf->m_written.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        buf->m_name.clear();
+    }
+    else
+    {
+        reg.m_buffers.emplace_back(new ThreadBuffer);
+        buf = reg.m_buffers.back().get();
+    }
+    buf->m_tid = ++reg.m_nextTid;
+    reg.m_current.reset(buf);
+
+    static thread_local ThreadRelease Release;
+    Release.m_buf = buf;
+    return *buf;
+}
+
+/* Ticks per microsecond, measured against the steady clock since registry creation */
+double CalibrateTicks(Registry& reg)
+{
+#if __x86_64__ || __i386__ || _M_X64 || _M_IX86
+    auto now = std::chrono::steady_clock::now();
+    if (now - reg.m_baseTime < std::chrono::milliseconds(10))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        now = std::chrono::steady_clock::now();
+    }
+    uint64_t ticks = Now();
+    double us = std::chrono::duration<double, std::micro>(now - reg.m_baseTime).count();
+    return (ticks - reg.m_baseTicks) / us;
+#else
+    return 1000.0;
+#endif
+}
+
+void AppendEscaped(std::string& out, const char* str)
+{
+    for (const char* ch = str ; *ch ; ++ch)
+    {
+        if (*ch == '"' || *ch == '\\')
+            out += '\\';
+        out += *ch;
+    }
+}
+
+}
+
+void SetEnabled(bool enabled)
+{
+    GetRegistry();
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Record(const char* name, uint64_t begin, uint64_t end)
+{
+    ThreadBuffer& buf = GetThreadBuffer();
+    uint64_t idx = buf.m_written.load(std::memory_order_relaxed);
+    Event& ev = buf.m_events[idx % ThreadBuffer::Capacity];
+    /* Orders the previous publish before these stores, so a reader that sees
+     * any of them also sees m_written >= idx */
+    std::atomic_thread_fence(std::memory_order_release);
+    ev.m_name.store(name, std::memory_order_relaxed);
+    ev.m_begin.store(begin, std::memory_order_relaxed);
+    ev.m_end.store(end, std::memory_order_relaxed);
+    buf.m_written.store(idx + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char* name)
+{
+    ThreadBuffer& buf = GetThreadBuffer();
+    std::unique_lock<std::mutex> lk(GetRegistry().m_lock);
+    buf.m_name = name;
+}
+
+void Clear()
+{
+    Registry& reg = GetRegistry();
+    std::unique_lock<std::mutex> lk(reg.m_lock);
+    for (auto& buf : reg.m_buffers)
+        buf->m_clearedAt.store(buf->m_written.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::string GetChromeJSON()
+{
+    Registry& reg = GetRegistry();
+    double ticksPerUs = CalibrateTicks(reg);
+
+    std::string out = "{\"traceEvents\":[";
+    bool first = true;
+    char num[128];
+
+    struct EventCopy
+    {
+        const char* m_name;
+        uint64_t m_begin;
+        uint64_t m_end;
+    };
+    std::vector<EventCopy> events;
+    events.reserve(ThreadBuffer::Capacity);
+
+    std::unique_lock<std::mutex> lk(reg.m_lock);
+    for (auto& buf : reg.m_buffers)
+    {
+        if (buf->m_name.size())
+        {
+            if (!first)
+                out += ',';
+            first = false;
+            snprintf(num, 128, "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"",
+                     buf->m_tid);
+            out += num;
+            AppendEscaped(out, buf->m_name.c_str());
+            out += "\"}}";
+        }
+
+        uint64_t end = buf->m_written.load(std::memory_order_acquire);
+        uint64_t begin = buf->m_clearedAt.load(std::memory_order_relaxed);
+        if (end - begin > ThreadBuffer::Capacity)
+            begin = end - ThreadBuffer::Capacity;
+
+        /* Snapshot the committed entries, then keep only those the writer
+         * cannot have started overwriting while we copied */
+        events.clear();
+        for (uint64_t i=begin ; i<end ; ++i)
+        {
+            const Event& ev = buf->m_events[i % ThreadBuffer::Capacity];
+            events.push_back({ev.m_name.load(std::memory_order_relaxed),
+                              ev.m_begin.load(std::memory_order_relaxed),
+                              ev.m_end.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t written = buf->m_written.load(std::memory_order_relaxed);
+        if (written >= ThreadBuffer::Capacity && written - ThreadBuffer::Capacity + 1 > begin)
+            begin = std::min(written - ThreadBuffer::Capacity + 1, end);
+
+        for (uint64_t i=begin ; i<end ; ++i)
+        {
+            const EventCopy& ev = events[i - (end - events.size())];
+            if (ev.m_begin < reg.m_baseTicks)
+                continue;
+            if (!first)
+                out += ',';
+            first = false;
+            out += "{\"ph\":\"X\",\"pid\":1,\"name\":\"";
+            AppendEscaped(out, ev.m_name);
+            snprintf(num, 128, "\",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buf->m_tid,
+                     (ev.m_begin - reg.m_baseTicks) / ticksPerUs,
+                     (ev.m_end - ev.m_begin) / ticksPerUs);
+            out += num;
+        }
+    }
+    out += "],\"displayTimeUnit\":\"ms\"}";
+    return out;
+}
+
+bool WriteChromeJSON(const char* path)
+{
+    std::string json = GetChromeJSON();
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        Log.report(logvisor::Error, "unable to open '%s' for writing", path);
+        return false;
+    }
+    fwrite(json.data(), 1, json.size(), fp);
+    fclose(fp);
+    return true;
+}
+
+}
+}
@@ -1,11 +1,17 @@
 #include <memory>
 #include <list>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string.h>
 #include "AudioVoiceEngine.hpp"
 #include "logvisor/logvisor.hpp"
 
 #include <alsa/asoundlib.h>
-#include <signal.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
 
 static inline double TimespecToDouble(struct timespec& ts)
 {
@@ -181,6 +187,7 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
             Log.report(logvisor::Fatal, "unsupported audio sample rates on default ALSA device");
             return;
         }
+        _resetMixQuantum();
 
         snd_pcm_hw_params_free(hwParams);
 
@@ -377,57 +384,263 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
         return ret;
     }
 
-    /* Empty handler for SIGQUIT */
-    static void _sigquit(int) {}
-
-    static void MIDIReceiveProc(snd_rawmidi_t* midi, const ReceiveFunctor& receiver, bool& running)
+    /* Single thread servicing every open rawmidi input. Inputs are read in
+     * non-blocking mode as poll() reports them ready; an eventfd wakes the
+     * thread when the input set changes or on shutdown */
+    class MIDIReactor
     {
-        struct sigaction s;
-        s.sa_handler = _sigquit;
-        sigemptyset(&s.sa_mask);
-        s.sa_flags = 0;
-        sigaction(SIGQUIT, &s, nullptr);
-
-        snd_rawmidi_status_t* midiStatus;
-        snd_rawmidi_status_malloc(&midiStatus);
-
-        uint8_t buf[512];
-        while (running)
-        {
-            snd_htimestamp_t ts;
-            snd_rawmidi_status(midi, midiStatus);
-            snd_rawmidi_status_get_tstamp(midiStatus, &ts);
-            int rdBytes = snd_rawmidi_read(midi, buf, 512);
-            if (rdBytes < 0)
+        struct Input
+        {
+            snd_rawmidi_t* m_midi;
+            const ReceiveFunctor* m_receiver;
+            bool m_lost;
+        };
+
+        struct PollSpan
+        {
+            size_t m_input;
+            size_t m_fdOffset;
+            int m_fdCount;
+        };
+
+        std::mutex m_lock;
+        std::vector<Input> m_inputs;
+        uint64_t m_generation = 0;
+        int m_eventFd;
+        bool m_running = true;
+        std::thread m_thread;
+
+        /* Receivers run without m_lock so they may add or remove ports; removeInput
+         * waits on m_dispatchCv while its port is being dispatched, or flags
+         * m_dispatchRemoved when called from within that port's receiver */
+        std::condition_variable m_dispatchCv;
+        snd_rawmidi_t* m_dispatching = nullptr;
+        std::atomic_bool m_dispatchRemoved = {false};
+
+        void _wake()
+        {
+            uint64_t one = 1;
+            if (write(m_eventFd, &one, sizeof(one)) < 0)
+                Log.report(logvisor::Error, "unable to wake MIDI thread");
+        }
+
+        void _drainWake()
+        {
+            uint64_t val;
+            ssize_t ret = read(m_eventFd, &val, sizeof(val));
+            (void)ret;
+        }
+
+        void _readInput(std::unique_lock<std::mutex>& lk, const Input& input,
+                        snd_rawmidi_status_t* midiStatus)
+        {
+            snd_rawmidi_t* midi = input.m_midi;
+            const ReceiveFunctor* receiver = input.m_receiver;
+            m_dispatching = midi;
+            m_dispatchRemoved = false;
+            lk.unlock();
+
+            bool lost = false;
+            uint8_t buf[512];
+            for (;;)
             {
-                if (rdBytes != -EINTR)
+                snd_htimestamp_t ts;
+                snd_rawmidi_status(midi, midiStatus);
+                snd_rawmidi_status_get_tstamp(midiStatus, &ts);
+                ssize_t rdBytes = snd_rawmidi_read(midi, buf, sizeof(buf));
+                if (rdBytes == -EAGAIN)
+                    break;
+                if (rdBytes < 0)
+                {
                     Log.report(logvisor::Error, "MIDI connection lost");
-                running = false;
-                break;
+                    lost = true;
+                    break;
+                }
+
+                (*receiver)(buf, size_t(rdBytes), TimespecToDouble(ts));
+                if (m_dispatchRemoved.load() || size_t(rdBytes) < sizeof(buf))
+                    break;
             }
 
-            receiver(std::vector<uint8_t>(std::cbegin(buf), std::cbegin(buf) + rdBytes), TimespecToDouble(ts));
+            lk.lock();
+            m_dispatching = nullptr;
+            m_dispatchCv.notify_all();
+            if (lost)
+            {
+                for (Input& in : m_inputs)
+                {
+                    if (in.m_midi == midi)
+                    {
+                        in.m_lost = true;
+                        ++m_generation;
+                        break;
+                    }
+                }
+            }
         }
 
-        snd_rawmidi_status_free(midiStatus);
+        void _proc()
+        {
+            snd_rawmidi_status_t* midiStatus;
+            snd_rawmidi_status_malloc(&midiStatus);
+
+            std::vector<pollfd> fds;
+            std::vector<PollSpan> spans;
+
+            std::unique_lock<std::mutex> lk(m_lock);
+            uint64_t generation = m_generation - 1;
+            while (m_running)
+            {
+                if (generation != m_generation)
+                {
+                    /* Rebuild descriptor set; slot 0 is always the eventfd */
+                    generation = m_generation;
+                    fds.clear();
+                    spans.clear();
+                    fds.push_back({m_eventFd, POLLIN, 0});
+                    for (size_t i=0 ; i<m_inputs.size() ; ++i)
+                    {
+                        Input& input = m_inputs[i];
+                        if (input.m_lost)
+                            continue;
+                        int count = snd_rawmidi_poll_descriptors_count(input.m_midi);
+                        if (count <= 0)
+                            continue;
+                        size_t offset = fds.size();
+                        fds.resize(offset + count);
+                        count = snd_rawmidi_poll_descriptors(input.m_midi, &fds[offset], count);
+                        fds.resize(offset + count);
+                        spans.push_back({i, offset, count});
+                    }
+                }
+
+                lk.unlock();
+                int ready = poll(fds.data(), fds.size(), -1);
+                lk.lock();
+                if (ready < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    Log.report(logvisor::Error, "MIDI poll failed: %s", strerror(errno));
+                    break;
+                }
+
+                if (fds[0].revents & POLLIN)
+                    _drainWake();
+
+                /* Inputs added or removed while polling; pending bytes are picked up next pass */
+                if (generation != m_generation)
+                    continue;
+
+                for (const PollSpan& span : spans)
+                {
+                    Input& input = m_inputs[span.m_input];
+                    unsigned short revents = 0;
+                    snd_rawmidi_poll_descriptors_revents(input.m_midi, &fds[span.m_fdOffset],
+                                                         span.m_fdCount, &revents);
+                    if (revents & POLLIN)
+                        _readInput(lk, input, midiStatus);
+                    else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                    {
+                        Log.report(logvisor::Error, "MIDI connection lost");
+                        input.m_lost = true;
+                        ++m_generation;
+                    }
+
+                    /* Receiver changed the input set; remaining spans are stale */
+                    if (generation != m_generation)
+                        break;
+                }
+            }
+
+            snd_rawmidi_status_free(midiStatus);
+        }
+
+    public:
+        MIDIReactor() : m_eventFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (m_eventFd < 0)
+                Log.report(logvisor::Error, "unable to create MIDI eventfd");
+        }
+
+        ~MIDIReactor()
+        {
+            {
+                std::unique_lock<std::mutex> lk(m_lock);
+                m_running = false;
+            }
+            if (m_thread.joinable())
+            {
+                _wake();
+                m_thread.join();
+            }
+            if (m_eventFd >= 0)
+                close(m_eventFd);
+        }
+
+        void addInput(snd_rawmidi_t* midi, const ReceiveFunctor& receiver)
+        {
+            if (m_eventFd < 0)
+                return;
+            snd_rawmidi_nonblock(midi, 1);
+            std::unique_lock<std::mutex> lk(m_lock);
+            m_inputs.push_back({midi, &receiver, false});
+            ++m_generation;
+            if (!m_thread.joinable())
+                m_thread = std::thread(std::bind(&MIDIReactor::_proc, this));
+            else
+                _wake();
+        }
+
+        /* Once this returns the receiver will not be called again
+         * (safe to call from within that receiver) */
+        void removeInput(snd_rawmidi_t* midi)
+        {
+            std::unique_lock<std::mutex> lk(m_lock);
+            for (auto it = m_inputs.begin() ; it != m_inputs.end() ; ++it)
+            {
+                if (it->m_midi == midi)
+                {
+                    m_inputs.erase(it);
+                    ++m_generation;
+                    _wake();
+                    break;
+                }
+            }
+
+            if (m_dispatching != midi)
+                return;
+            if (std::this_thread::get_id() == m_thread.get_id())
+                m_dispatchRemoved = true;
+            else
+                m_dispatchCv.wait(lk, [&]() {return m_dispatching != midi;});
+        }
+    };
+
+    std::shared_ptr<MIDIReactor> m_midiReactor;
+
+    const std::shared_ptr<MIDIReactor>& _midiReactor()
+    {
+        if (!m_midiReactor)
+            m_midiReactor = std::make_shared<MIDIReactor>();
+        return m_midiReactor;
     }
 
     struct MIDIIn : public IMIDIIn
     {
-        bool m_midiRunning = true;
+        std::shared_ptr<MIDIReactor> m_reactor;
         snd_rawmidi_t* m_midi;
-        std::thread m_midiThread;
 
-        MIDIIn(snd_rawmidi_t* midi, bool virt, ReceiveFunctor&& receiver)
-        : IMIDIIn(virt, std::move(receiver)), m_midi(midi),
-          m_midiThread(std::bind(MIDIReceiveProc, m_midi, m_receiver, m_midiRunning)) {}
+        MIDIIn(const std::shared_ptr<MIDIReactor>& reactor, snd_rawmidi_t* midi,
+               bool virt, ReceiveFunctor&& receiver)
+        : IMIDIIn(virt, std::move(receiver)), m_reactor(reactor), m_midi(midi)
+        {
+            m_reactor->addInput(m_midi, m_receiver);
+        }
 
         ~MIDIIn()
         {
-            m_midiRunning = false;
-            pthread_kill(m_midiThread.native_handle(), SIGQUIT);
-            if (m_midiThread.joinable())
-                m_midiThread.join();
+            m_reactor->removeInput(m_midi);
             snd_rawmidi_close(m_midi);
         }
 
@@ -466,21 +679,20 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
 
     struct MIDIInOut : public IMIDIInOut
     {
-        bool m_midiRunning = true;
+        std::shared_ptr<MIDIReactor> m_reactor;
         snd_rawmidi_t* m_midiIn;
         snd_rawmidi_t* m_midiOut;
-        std::thread m_midiThread;
 
-        MIDIInOut(snd_rawmidi_t* midiIn, snd_rawmidi_t* midiOut, bool virt, ReceiveFunctor&& receiver)
-        : IMIDIInOut(virt, std::move(receiver)), m_midiIn(midiIn), m_midiOut(midiOut),
-          m_midiThread(std::bind(MIDIReceiveProc, m_midiIn, m_receiver, m_midiRunning)) {}
+        MIDIInOut(const std::shared_ptr<MIDIReactor>& reactor, snd_rawmidi_t* midiIn,
+                  snd_rawmidi_t* midiOut, bool virt, ReceiveFunctor&& receiver)
+        : IMIDIInOut(virt, std::move(receiver)), m_reactor(reactor), m_midiIn(midiIn), m_midiOut(midiOut)
+        {
+            m_reactor->addInput(m_midiIn, m_receiver);
+        }
 
         ~MIDIInOut()
         {
-            m_midiRunning = false;
-            pthread_kill(m_midiThread.native_handle(), SIGQUIT);
-            if (m_midiThread.joinable())
-                m_midiThread.join();
+            m_reactor->removeInput(m_midiIn);
             snd_rawmidi_close(m_midiIn);
             snd_rawmidi_close(m_midiOut);
         }
@@ -507,7 +719,7 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
         status = snd_rawmidi_open(&midi, nullptr, "virtual", 0);
         if (status)
             return {};
-        return std::make_unique<MIDIIn>(midi, true, std::move(receiver));
+        return std::make_unique<MIDIIn>(_midiReactor(), midi, true, std::move(receiver));
     }
 
     std::unique_ptr<IMIDIOut> newVirtualMIDIOut()
@@ -528,7 +740,7 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
         status = snd_rawmidi_open(&midiIn, &midiOut, "virtual", 0);
         if (status)
             return {};
-        return std::make_unique<MIDIInOut>(midiIn, midiOut, true, std::move(receiver));
+        return std::make_unique<MIDIInOut>(_midiReactor(), midiIn, midiOut, true, std::move(receiver));
     }
 
     std::unique_ptr<IMIDIIn> newRealMIDIIn(const char* name, ReceiveFunctor&& receiver)
@@ -537,7 +749,7 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
         int status = snd_rawmidi_open(&midi, nullptr, name, 0);
         if (status)
             return {};
-        return std::make_unique<MIDIIn>(midi, true, std::move(receiver));
+        return std::make_unique<MIDIIn>(_midiReactor(), midi, true, std::move(receiver));
     }
 
     std::unique_ptr<IMIDIOut> newRealMIDIOut(const char* name)
@@ -556,7 +768,7 @@ struct ALSAAudioVoiceEngine : BaseAudioVoiceEngine
         int status = snd_rawmidi_open(&midiIn, &midiOut, name, 0);
         if (status)
             return {};
-        return std::make_unique<MIDIInOut>(midiIn, midiOut, true, std::move(receiver));
+        return std::make_unique<MIDIInOut>(_midiReactor(), midiIn, midiOut, true, std::move(receiver));
     }
 
     bool useMIDILock() const {return true;}
@@ -255,8 +255,8 @@ struct AQSAudioVoiceEngine : BaseAudioVoiceEngine
         const MIDIPacket* packet = &pktlist->packet[0];
         for (int i=0 ; i<pktlist->numPackets ; ++i)
         {
-            std::vector<uint8_t> bytes(std::cbegin(packet->data), std::cbegin(packet->data) + packet->length);
-            readProcRefCon->m_receiver(std::move(bytes), AudioConvertHostTimeToNanos(packet->timeStamp) / 1.0e9);
+            readProcRefCon->m_receiver(packet->data, packet->length,
+                                       AudioConvertHostTimeToNanos(packet->timeStamp) / 1.0e9);
             packet = MIDIPacketNext(packet);
         }
     }
@@ -624,6 +624,7 @@ struct AQSAudioVoiceEngine : BaseAudioVoiceEngine
         m_mixInfo.m_sampleFormat = SOXR_FLOAT32_I;
         m_mixInfo.m_bitsPerSample = 32;
         m_5msFrames = actualSampleRate * 5 / 1000;
+        _resetMixQuantum();
 
         ChannelMap& chMapOut = m_mixInfo.m_channelMap;
         if (chCount > 2)
@@ -0,0 +1,519 @@
+#include "AudioSampler.hpp"
+#include "AudioVoiceEngine.hpp"
+#include "logvisor/logvisor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace boo
+{
+static logvisor::Module Log("boo::AudioSampler");
+
+static AudioMatrixStereo DefaultStereoMtx;
+
+/* Used when client supplies no callback; sampler voices never request PCM */
+static struct SamplerNullCallback : IAudioVoiceCallback
+{
+    void preSupplyAudio(IAudioVoice&, double) {}
+    size_t supplyAudio(IAudioVoice&, size_t, int16_t*) {return 0;}
+} NullCallback;
+
+AudioSampler::AudioSampler(BaseAudioVoiceEngine& root, IAudioVoiceCallback* cb, size_t polyphony)
+: AudioVoice(root, cb ? cb : &NullCallback, false), m_slots(polyphony)
+{
+    m_sampleRateIn = m_sampleRateOut = m_root.mixInfo().m_sampleRate;
+    m_renderBuf.resize(m_root.m_mixQuantumFrames * 2);
+}
+
+void AudioSampler::_resetSampleRate(double sampleRate)
+{
+    /* Zones carry their own rates; output rate is fixed by the engine */
+    m_resetSampleRate = false;
+}
+
+void AudioSampler::addZone(const SamplerZone& zone)
+{
+    if (!zone.m_samples || !zone.m_frames || zone.m_channels < 1 || zone.m_channels > 2)
+    {
+        Log.report(logvisor::Error, "invalid sampler zone");
+        return;
+    }
+    m_zones.push_back(zone);
+    for (Slot& slot : m_slots)
+        slot = Slot();
+}
+
+void AudioSampler::clearZones()
+{
+    m_zones.clear();
+    for (Slot& slot : m_slots)
+        slot = Slot();
+}
+
+void AudioSampler::_pushCommand(const Command& cmd)
+{
+    std::unique_lock<std::mutex> lk(m_pushLock);
+    size_t head = m_cmdHead.load(std::memory_order_relaxed);
+    size_t next = (head + 1) % CommandCapacity;
+    if (next == m_cmdTail.load(std::memory_order_acquire))
+        return;
+    m_commands[head] = cmd;
+    m_cmdHead.store(next, std::memory_order_release);
+}
+
+void AudioSampler::noteOff(uint8_t chan, uint8_t key, uint8_t velocity)
+{
+    _pushCommand({Command::Type::NoteOff, chan, key, velocity, 0});
+}
+
+void AudioSampler::noteOn(uint8_t chan, uint8_t key, uint8_t velocity)
+{
+    _pushCommand({Command::Type::NoteOn, chan, key, velocity, 0});
+}
+
+void AudioSampler::controlChange(uint8_t chan, uint8_t control, uint8_t value)
+{
+    _pushCommand({Command::Type::ControlChange, chan, control, value, 0});
+}
+
+void AudioSampler::pitchBend(uint8_t chan, int16_t pitch)
+{
+    _pushCommand({Command::Type::PitchBend, chan, 0, 0, pitch});
+}
+
+void AudioSampler::allSoundOff(uint8_t chan)
+{
+    _pushCommand({Command::Type::AllSoundOff, chan, 0, 0, 0});
+}
+
+void AudioSampler::resetAllControllers(uint8_t chan)
+{
+    _pushCommand({Command::Type::ResetControllers, chan, 0, 0, 0});
+}
+
+void AudioSampler::allNotesOff(uint8_t chan)
+{
+    _pushCommand({Command::Type::AllNotesOff, chan, 0, 0, 0});
+}
+
+void AudioSampler::reset()
+{
+    for (uint8_t chan=0 ; chan<16 ; ++chan)
+    {
+        allSoundOff(chan);
+        resetAllControllers(chan);
+    }
+}
+
+void AudioSampler::_applyCommands()
+{
+    size_t tail = m_cmdTail.load(std::memory_order_relaxed);
+    size_t head = m_cmdHead.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        const Command& cmd = m_commands[tail];
+        uint8_t chan = cmd.m_chan & 0xf;
+        switch (cmd.m_type)
+        {
+        case Command::Type::NoteOn:
+            if (cmd.m_b)
+                _noteOn(chan, cmd.m_a, cmd.m_b);
+            else
+                _noteOff(chan, cmd.m_a);
+            break;
+        case Command::Type::NoteOff:
+            _noteOff(chan, cmd.m_a);
+            break;
+        case Command::Type::ControlChange:
+            _controlChange(chan, cmd.m_a, cmd.m_b);
+            break;
+        case Command::Type::PitchBend:
+            m_channels[chan].m_bendSemitones = (cmd.m_bend - 8192) / 8192.f * m_bendRange;
+            break;
+        case Command::Type::AllNotesOff:
+            _controlChange(chan, 123, 0);
+            break;
+        case Command::Type::AllSoundOff:
+            _controlChange(chan, 120, 0);
+            break;
+        case Command::Type::ResetControllers:
+            _controlChange(chan, 121, 0);
+            break;
+        }
+        tail = (tail + 1) % CommandCapacity;
+    }
+    m_cmdTail.store(tail, std::memory_order_release);
+}
+
+AudioSampler::Slot* AudioSampler::_allocSlot(int priority)
+{
+    Slot* victim = nullptr;
+    for (Slot& slot : m_slots)
+    {
+        if (slot.m_stage == EnvStage::Off)
+            return &slot;
+
+        if (!victim)
+        {
+            victim = &slot;
+            continue;
+        }
+
+        if (m_stealMode == SamplerStealMode::Priority &&
+            slot.m_zone->m_priority != victim->m_zone->m_priority)
+        {
+            if (slot.m_zone->m_priority < victim->m_zone->m_priority)
+                victim = &slot;
+            continue;
+        }
+
+        bool slotReleasing = slot.m_stage == EnvStage::Release;
+        bool victimReleasing = victim->m_stage == EnvStage::Release;
+        if (slotReleasing != victimReleasing)
+        {
+            if (slotReleasing)
+                victim = &slot;
+            continue;
+        }
+
+        if (slot.m_age < victim->m_age)
+            victim = &slot;
+    }
+
+    if (victim && m_stealMode == SamplerStealMode::Priority && victim->m_zone->m_priority > priority)
+        return nullptr;
+    return victim;
+}
+
+void AudioSampler::_noteOn(uint8_t chan, uint8_t key, uint8_t velocity)
+{
+    for (const SamplerZone& zone : m_zones)
+    {
+        if (key < zone.m_keyLo || key > zone.m_keyHi ||
+            velocity < zone.m_velLo || velocity > zone.m_velHi ||
+            (zone.m_channel != 0xff && zone.m_channel != chan))
+            continue;
+
+        Slot* slot = _allocSlot(zone.m_priority);
+        if (!slot)
+            continue;
+
+        const SamplerEnvelope& env = zone.m_envelope;
+        float sustain = std::min(std::max(env.m_sustain, 0.f), 1.f);
+        float rate = float(m_sampleRateOut);
+
+        slot->m_zone = &zone;
+        slot->m_stage = EnvStage::Attack;
+        slot->m_chan = chan;
+        slot->m_key = key;
+        slot->m_held = true;
+        slot->m_sustained = false;
+        slot->m_age = ++m_ageCounter;
+        slot->m_pos = 0.0;
+        slot->m_velGain = velocity / 127.f;
+        slot->m_level = 0.f;
+        slot->m_attackStep = env.m_attack > 0.f ? 1.f / (env.m_attack * rate) : 1.f;
+        slot->m_decayStep = env.m_decay > 0.f ? (1.f - sustain) / (env.m_decay * rate) : 1.f;
+        slot->m_releaseStep = 0.f;
+    }
+}
+
+void AudioSampler::_releaseSlot(Slot& slot)
+{
+    slot.m_held = false;
+    slot.m_sustained = false;
+    if (slot.m_stage == EnvStage::Off || slot.m_stage == EnvStage::Release)
+        return;
+    float release = slot.m_zone->m_envelope.m_release;
+    slot.m_stage = EnvStage::Release;
+    slot.m_releaseStep = release > 0.f ? slot.m_level / (release * float(m_sampleRateOut)) : 1.f;
+    if (slot.m_releaseStep <= 0.f)
+        slot.m_stage = EnvStage::Off;
+}
+
+void AudioSampler::_noteOff(uint8_t chan, uint8_t key)
+{
+    for (Slot& slot : m_slots)
+    {
+        if (!slot.m_held || slot.m_chan != chan || slot.m_key != key)
+            continue;
+        if (m_channels[chan].m_sustain)
+        {
+            slot.m_held = false;
+            slot.m_sustained = true;
+        }
+        else
+            _releaseSlot(slot);
+    }
+}
+
+void AudioSampler::_controlChange(uint8_t chan, uint8_t control, uint8_t value)
+{
+    Channel& channel = m_channels[chan];
+    switch (control)
+    {
+    case 7:
+        channel.m_volume = value;
+        break;
+    case 10:
+        channel.m_pan = value;
+        break;
+    case 11:
+        channel.m_expression = value;
+        break;
+    case 64:
+        channel.m_sustain = value >= 64;
+        if (!channel.m_sustain)
+            for (Slot& slot : m_slots)
+                if (slot.m_sustained && slot.m_chan == chan)
+                    _releaseSlot(slot);
+        break;
+    case 120: /* All sound off */
+        for (Slot& slot : m_slots)
+            if (slot.m_chan == chan)
+                slot.m_stage = EnvStage::Off;
+        break;
+    case 121: /* Reset all controllers */
+        channel = Channel();
+        for (Slot& slot : m_slots)
+            if (slot.m_sustained && slot.m_chan == chan)
+                _releaseSlot(slot);
+        break;
+    case 123: /* All notes off */
+        for (Slot& slot : m_slots)
+            if ((slot.m_held || slot.m_sustained) && slot.m_chan == chan)
+                _releaseSlot(slot);
+        break;
+    default: break;
+    }
+}
+
+void AudioSampler::_render(float* out, size_t frames)
+{
+    memset(out, 0, frames * 2 * sizeof(float));
+    size_t active = 0;
+
+    for (Slot& slot : m_slots)
+    {
+        if (slot.m_stage == EnvStage::Off)
+            continue;
+
+        const SamplerZone& zone = *slot.m_zone;
+        const Channel& chan = m_channels[slot.m_chan];
+
+        /* Per-block pitch and gain; envelope and interpolation run per frame */
+        double inc = zone.m_sampleRate / m_sampleRateOut * m_pitchRatio *
+            std::exp2((int(slot.m_key) - int(zone.m_rootKey) + chan.m_bendSemitones) / 12.0);
+        float gain = slot.m_velGain * zone.m_gain * (chan.m_volume / 127.f) *
+            (chan.m_expression / 127.f) / 32768.f;
+        float balance = std::min(std::max((int(chan.m_pan) - 64) / 63.f, -1.f), 1.f);
+        float gainL = gain * std::min(1.f, 1.f - balance);
+        float gainR = gain * std::min(1.f, 1.f + balance);
+        float sustain = std::min(std::max(zone.m_envelope.m_sustain, 0.f), 1.f);
+
+        bool loop = zone.m_loopEnd > zone.m_loopStart && zone.m_loopEnd <= zone.m_frames;
+        size_t end = loop ? zone.m_loopEnd : zone.m_frames;
+        double loopLen = double(zone.m_loopEnd - zone.m_loopStart);
+        const int16_t* pcm = zone.m_samples;
+
+        for (size_t i=0 ; i<frames ; ++i)
+        {
+            switch (slot.m_stage)
+            {
+            case EnvStage::Attack:
+                slot.m_level += slot.m_attackStep;
+                if (slot.m_level >= 1.f)
+                {
+                    slot.m_level = 1.f;
+                    slot.m_stage = EnvStage::Decay;
+                }
+                break;
+            case EnvStage::Decay:
+                slot.m_level -= slot.m_decayStep;
+                if (slot.m_level <= sustain)
+                {
+                    slot.m_level = sustain;
+                    slot.m_stage = sustain > 0.f ? EnvStage::Sustain : EnvStage::Off;
+                }
+                break;
+            case EnvStage::Release:
+                slot.m_level -= slot.m_releaseStep;
+                if (slot.m_level <= 0.f)
+                {
+                    slot.m_level = 0.f;
+                    slot.m_stage = EnvStage::Off;
+                }
+                break;
+            default: break;
+            }
+            if (slot.m_stage == EnvStage::Off)
+                break;
+
+            size_t idx = size_t(slot.m_pos);
+            float frac = float(slot.m_pos - idx);
+            size_t next = idx + 1;
+            if (next >= end)
+                next = loop ? zone.m_loopStart : idx;
+
+            if (zone.m_channels == 2)
+            {
+                float l = pcm[idx*2] + (pcm[next*2] - pcm[idx*2]) * frac;
+                float r = pcm[idx*2+1] + (pcm[next*2+1] - pcm[idx*2+1]) * frac;
+                out[i*2] += l * slot.m_level * gainL;
+                out[i*2+1] += r * slot.m_level * gainR;
+            }
+            else
+            {
+                float s = (pcm[idx] + (pcm[next] - pcm[idx]) * frac) * slot.m_level;
+                out[i*2] += s * gainL;
+                out[i*2+1] += s * gainR;
+            }
+
+            slot.m_pos += inc;
+            if (slot.m_pos >= end)
+            {
+                if (!loop)
+                {
+                    slot.m_stage = EnvStage::Off;
+                    break;
+                }
+                slot.m_pos = zone.m_loopStart + std::fmod(slot.m_pos - zone.m_loopStart, loopLen);
+            }
+        }
+
+        if (slot.m_stage != EnvStage::Off)
+            ++active;
+        else
+            slot.m_held = slot.m_sustained = false;
+    }
+
+    m_activeCount.store(active, std::memory_order_relaxed);
+}
+
+static inline void ConvertRendered(const float* in, float* out, size_t samples) {}
+
+static inline void ConvertRendered(const float* in, int16_t* out, size_t samples)
+{
+    for (size_t i=0 ; i<samples ; ++i)
+        out[i] = Clamp16(in[i] * 32767.f);
+}
+
+static inline void ConvertRendered(const float* in, int32_t* out, size_t samples)
+{
+    for (size_t i=0 ; i<samples ; ++i)
+        out[i] = Clamp32(in[i] * 2147483647.f);
+}
+
+/* Float output renders in place; integer formats render to float and convert */
+float* AudioSampler::_getRenderBuf(float* scratchPre, size_t samples)
+{return scratchPre;}
+
+template <typename T>
+float* AudioSampler::_getRenderBuf(T* scratchPre, size_t samples)
+{
+    if (m_renderBuf.size() < samples)
+        m_renderBuf.resize(samples);
+    return m_renderBuf.data();
+}
+
+int16_t* AudioSampler::_getMergeBuf(AudioSubmix& smx, size_t frames, int16_t*)
+{return smx._getMergeBuf16(frames);}
+int32_t* AudioSampler::_getMergeBuf(AudioSubmix& smx, size_t frames, int32_t*)
+{return smx._getMergeBuf32(frames);}
+float* AudioSampler::_getMergeBuf(AudioSubmix& smx, size_t frames, float*)
+{return smx._getMergeBufFlt(frames);}
+
+template <typename T>
+size_t AudioSampler::_pumpAndMix(size_t frames, std::vector<T>& scratchPre, std::vector<T>& scratchPost)
+{
+    size_t samples = frames * 2;
+    if (scratchPre.size() < samples)
+        scratchPre.resize(samples);
+    if (scratchPost.size() < samples)
+        scratchPost.resize(samples);
+
+    double dt = frames / m_sampleRateOut;
+    m_cb->preSupplyAudio(*this, dt);
+    _midUpdate();
+    _applyCommands();
+
+    /* Nothing sounding; leave the submixes untouched */
+    if (std::none_of(m_slots.cbegin(), m_slots.cend(),
+                     [](const Slot& s) { return s.m_stage != EnvStage::Off; }))
+        return frames;
+
+    float* renderOut = _getRenderBuf(scratchPre.data(), samples);
+    _render(renderOut, frames);
+    ConvertRendered(renderOut, scratchPre.data(), samples);
+
+    if (m_sendMatrices.size())
+    {
+        for (auto& mtx : m_sendMatrices)
+        {
+            AudioSubmix& smx = *reinterpret_cast<AudioSubmix*>(mtx.first);
+            m_cb->routeAudio(frames, 2, dt, smx.m_busId, scratchPre.data(), scratchPost.data());
+            mtx.second.mixStereoSampleData(m_root.m_mixInfo, scratchPost.data(),
+                                           _getMergeBuf(smx, frames, scratchPost.data()), frames);
+        }
+    }
+    else
+    {
+        AudioSubmix& smx = reinterpret_cast<AudioSubmix&>(m_root.m_mainSubmix);
+        m_cb->routeAudio(frames, 2, dt, m_root.m_mainSubmix.m_busId, scratchPre.data(), scratchPost.data());
+        DefaultStereoMtx.mixStereoSampleData(m_root.m_mixInfo, scratchPost.data(),
+                                             _getMergeBuf(smx, frames, scratchPost.data()), frames);
+    }
+
+    return frames;
+}
+
+size_t AudioSampler::pumpAndMix16(size_t frames)
+{
+    return _pumpAndMix(frames, m_root.m_scratch16Pre, m_root.m_scratch16Post);
+}
+
+size_t AudioSampler::pumpAndMix32(size_t frames)
+{
+    return _pumpAndMix(frames, m_root.m_scratch32Pre, m_root.m_scratch32Post);
+}
+
+size_t AudioSampler::pumpAndMixFlt(size_t frames)
+{
+    return _pumpAndMix(frames, m_root.m_scratchFltPre, m_root.m_scratchFltPost);
+}
+
+void AudioSampler::resetChannelLevels()
+{
+    m_root.m_submixesDirty = true;
+    m_sendMatrices.clear();
+    m_cachedSend = nullptr;
+}
+
+void AudioSampler::setMonoChannelLevels(IAudioSubmix* submix, const float coefs[8], bool slew)
+{
+    float newCoefs[8][2] =
+    {
+        {coefs[0], coefs[0]},
+        {coefs[1], coefs[1]},
+        {coefs[2], coefs[2]},
+        {coefs[3], coefs[3]},
+        {coefs[4], coefs[4]},
+        {coefs[5], coefs[5]},
+        {coefs[6], coefs[6]},
+        {coefs[7], coefs[7]}
+    };
+    setStereoChannelLevels(submix, newCoefs, slew);
+}
+
+void AudioSampler::setStereoChannelLevels(IAudioSubmix* submix, const float coefs[8][2], bool slew)
+{
+    if (!submix)
+        submix = &m_root.m_mainSubmix;
+
+    auto search = m_sendMatrices.find(submix);
+    if (search == m_sendMatrices.cend())
+        search = m_sendMatrices.emplace(submix, AudioMatrixStereo{}).first;
+    _cacheSend(submix, search->second);
+    search->second.setMatrixCoefficients(coefs, slew ? m_root.m_mixQuantumFrames : 0);
+}
+
+}
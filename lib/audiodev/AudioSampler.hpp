@@ -0,0 +1,156 @@
+#ifndef BOO_AUDIOSAMPLER_HPP
+#define BOO_AUDIOSAMPLER_HPP
+
+#include "boo/audiodev/IAudioSampler.hpp"
+#include "AudioVoice.hpp"
+#include <atomic>
+#include <mutex>
+
+namespace boo
+{
+
+class AudioSubmix;
+
+class AudioSampler : public AudioVoice, public IAudioSampler
+{
+    /* MIDI command queued for the mix thread */
+    struct Command
+    {
+        enum class Type : uint8_t
+        {
+            NoteOn,
+            NoteOff,
+            ControlChange,
+            PitchBend,
+            AllNotesOff,
+            AllSoundOff,
+            ResetControllers
+        };
+        Type m_type;
+        uint8_t m_chan;
+        uint8_t m_a;
+        uint8_t m_b;
+        int16_t m_bend;
+    };
+
+    static constexpr size_t CommandCapacity = 512;
+    Command m_commands[CommandCapacity];
+    std::atomic_size_t m_cmdHead = {0};
+    std::atomic_size_t m_cmdTail = {0};
+    std::mutex m_pushLock;
+    void _pushCommand(const Command& cmd);
+    void _applyCommands();
+
+    enum class EnvStage : uint8_t
+    {
+        Off,
+        Attack,
+        Decay,
+        Sustain,
+        Release
+    };
+
+    struct Slot
+    {
+        const SamplerZone* m_zone = nullptr;
+        EnvStage m_stage = EnvStage::Off;
+        uint8_t m_chan = 0;
+        uint8_t m_key = 0;
+        bool m_held = false;
+        bool m_sustained = false;
+        uint64_t m_age = 0;
+        double m_pos = 0.0;
+        float m_velGain = 0.f;
+        float m_level = 0.f;
+        float m_attackStep = 0.f;
+        float m_decayStep = 0.f;
+        float m_releaseStep = 0.f;
+    };
+
+    struct Channel
+    {
+        float m_bendSemitones = 0.f;
+        uint8_t m_volume = 100;
+        uint8_t m_expression = 127;
+        uint8_t m_pan = 64;
+        bool m_sustain = false;
+    };
+
+    std::vector<SamplerZone> m_zones;
+    std::vector<Slot> m_slots;
+    Channel m_channels[16];
+    uint64_t m_ageCounter = 0;
+    SamplerStealMode m_stealMode = SamplerStealMode::Oldest;
+    float m_bendRange = 2.f;
+    std::atomic_size_t m_activeCount = {0};
+
+    std::unordered_map<IAudioSubmix*, AudioMatrixStereo> m_sendMatrices;
+    std::vector<float> m_renderBuf;
+
+    Slot* _allocSlot(int priority);
+    void _noteOn(uint8_t chan, uint8_t key, uint8_t velocity);
+    void _noteOff(uint8_t chan, uint8_t key);
+    void _releaseSlot(Slot& slot);
+    void _controlChange(uint8_t chan, uint8_t control, uint8_t value);
+    void _render(float* out, size_t frames);
+    float* _getRenderBuf(float* scratchPre, size_t samples);
+    template <typename T>
+    float* _getRenderBuf(T* scratchPre, size_t samples);
+    static int16_t* _getMergeBuf(AudioSubmix& smx, size_t frames, int16_t*);
+    static int32_t* _getMergeBuf(AudioSubmix& smx, size_t frames, int32_t*);
+    static float* _getMergeBuf(AudioSubmix& smx, size_t frames, float*);
+
+    void _resetSampleRate(double sampleRate);
+
+    template <typename T>
+    size_t _pumpAndMix(size_t frames, std::vector<T>& scratchPre, std::vector<T>& scratchPost);
+    size_t pumpAndMix16(size_t frames);
+    size_t pumpAndMix32(size_t frames);
+    size_t pumpAndMixFlt(size_t frames);
+
+public:
+    AudioSampler(BaseAudioVoiceEngine& root, IAudioVoiceCallback* cb, size_t polyphony);
+
+    void resetChannelLevels();
+    void setMonoChannelLevels(IAudioSubmix* submix, const float coefs[8], bool slew);
+    void setStereoChannelLevels(IAudioSubmix* submix, const float coefs[8][2], bool slew);
+
+    IAudioVoice& voice() {return *this;}
+    void addZone(const SamplerZone& zone);
+    void clearZones();
+    void setStealMode(SamplerStealMode mode) {m_stealMode = mode;}
+    void setPitchBendRange(float semitones) {m_bendRange = semitones;}
+    size_t getActiveVoiceCount() const {return m_activeCount.load(std::memory_order_relaxed);}
+
+    void noteOff(uint8_t chan, uint8_t key, uint8_t velocity);
+    void noteOn(uint8_t chan, uint8_t key, uint8_t velocity);
+    void notePressure(uint8_t chan, uint8_t key, uint8_t pressure) {}
+    void controlChange(uint8_t chan, uint8_t control, uint8_t value);
+    void programChange(uint8_t chan, uint8_t program) {}
+    void channelPressure(uint8_t chan, uint8_t pressure) {}
+    void pitchBend(uint8_t chan, int16_t pitch);
+
+    void allSoundOff(uint8_t chan);
+    void resetAllControllers(uint8_t chan);
+    void localControl(uint8_t chan, bool on) {}
+    void allNotesOff(uint8_t chan);
+    void omniMode(uint8_t chan, bool on) {}
+    void polyMode(uint8_t chan, bool on) {}
+
+    void sysex(const void* data, size_t len) {}
+
+    void timeCodeQuarterFrame(uint8_t message, uint8_t value) {}
+    void songPositionPointer(uint16_t pointer) {}
+    void songSelect(uint8_t song) {}
+    void tuneRequest() {}
+
+    void startSeq() {}
+    void continueSeq() {}
+    void stopSeq() {}
+
+    void reset();
+};
+
+}
+
+#endif // BOO_AUDIOSAMPLER_HPP
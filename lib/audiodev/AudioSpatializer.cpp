@@ -0,0 +1,320 @@
+#include "boo/audiodev/AudioSpatializer.hpp"
+#include "boo/audiodev/IAudioSubmix.hpp"
+#include "boo/TaskScheduler.hpp"
+#include "AudioVoiceEngine.hpp"
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <cmath>
+
+#if __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace boo
+{
+
+/* Horizontal speaker ring in clockwise order; azimuth in degrees from front, positive right */
+struct SpeakerRing
+{
+    unsigned m_count;
+    AudioChannel m_chans[7];
+    float m_azimuth[7];
+};
+
+static const SpeakerRing QuadRing =
+{4, {AudioChannel::FrontLeft, AudioChannel::FrontRight, AudioChannel::RearRight, AudioChannel::RearLeft},
+    {-45.f, 45.f, 135.f, -135.f}};
+
+static const SpeakerRing S51Ring =
+{5, {AudioChannel::FrontCenter, AudioChannel::FrontRight, AudioChannel::RearRight,
+     AudioChannel::RearLeft, AudioChannel::FrontLeft},
+    {0.f, 30.f, 110.f, -110.f, -30.f}};
+
+static const SpeakerRing S71Ring =
+{7, {AudioChannel::FrontCenter, AudioChannel::FrontRight, AudioChannel::SideRight, AudioChannel::RearRight,
+     AudioChannel::RearLeft, AudioChannel::SideLeft, AudioChannel::FrontLeft},
+    {0.f, 30.f, 90.f, 150.f, -150.f, -90.f, -30.f}};
+
+/* Adjacent speaker pair with inverted 2x2 base matrix: gA = x*m_a[0] + z*m_a[1], etc. */
+struct SpeakerPair
+{
+    int m_chanA;
+    int m_chanB;
+    float m_a[2];
+    float m_b[2];
+};
+
+static constexpr float DegToRad = 3.14159265358979f / 180.f;
+
+static unsigned BuildPairs(const SpeakerRing& ring, SpeakerPair* pairs)
+{
+    for (unsigned i=0 ; i<ring.m_count ; ++i)
+    {
+        unsigned j = (i + 1) % ring.m_count;
+        float ax = std::sin(ring.m_azimuth[i] * DegToRad);
+        float az = std::cos(ring.m_azimuth[i] * DegToRad);
+        float bx = std::sin(ring.m_azimuth[j] * DegToRad);
+        float bz = std::cos(ring.m_azimuth[j] * DegToRad);
+        float invDet = 1.f / (ax * bz - az * bx);
+        SpeakerPair& pair = pairs[i];
+        pair.m_chanA = int(ring.m_chans[i]);
+        pair.m_chanB = int(ring.m_chans[j]);
+        pair.m_a[0] = bz * invDet;
+        pair.m_a[1] = -bx * invDet;
+        pair.m_b[0] = -az * invDet;
+        pair.m_b[1] = ax * invDet;
+    }
+    return ring.m_count;
+}
+
+/* Tolerance so emitters exactly on a speaker match both adjoining pairs */
+static constexpr float PairEpsilon = -1e-5f;
+static constexpr float DistEpsilon = 1e-6f;
+
+static void ComputeGainsScalar(const SpeakerRing* ring, const SpeakerPair* pairs,
+                               const SpatialListener& l, const SpatialEmitterBatch& batch,
+                               size_t begin, size_t end, float (*coefsOut)[8])
+{
+    for (size_t i=begin ; i<end ; ++i)
+    {
+        float dx = batch.m_x[i] - l.m_position[0];
+        float dy = batch.m_y[i] - l.m_position[1];
+        float dz = batch.m_z[i] - l.m_position[2];
+        float x = dx * l.m_right[0] + dy * l.m_right[1] + dz * l.m_right[2];
+        float y = dx * l.m_up[0] + dy * l.m_up[1] + dz * l.m_up[2];
+        float z = dx * l.m_front[0] + dy * l.m_front[1] + dz * l.m_front[2];
+
+        float h = std::sqrt(x * x + z * z);
+        float dist = std::sqrt(h * h + y * y);
+        float invH = h > DistEpsilon ? 1.f / h : 0.f;
+        float w = dist > DistEpsilon ? h / dist : 0.f;
+        x *= invH;
+        z *= invH;
+
+        float att = batch.m_minDistance /
+            std::min(std::max(dist, batch.m_minDistance), batch.m_maxDistance);
+        if (batch.m_gains)
+            att *= batch.m_gains[i];
+
+        float* coefs = coefsOut[i - begin];
+        for (int c=0 ; c<8 ; ++c)
+            coefs[c] = 0.f;
+
+        if (!ring)
+        {
+            float lat = x * w;
+            coefs[int(AudioChannel::FrontLeft)] = std::sqrt(std::max(0.f, (1.f - lat) * 0.5f)) * att;
+            coefs[int(AudioChannel::FrontRight)] = std::sqrt(std::max(0.f, (1.f + lat) * 0.5f)) * att;
+            continue;
+        }
+
+        for (unsigned p=0 ; p<ring->m_count ; ++p)
+        {
+            const SpeakerPair& pair = pairs[p];
+            float ga = x * pair.m_a[0] + z * pair.m_a[1];
+            float gb = x * pair.m_b[0] + z * pair.m_b[1];
+            if (ga >= PairEpsilon && gb >= PairEpsilon)
+            {
+                coefs[pair.m_chanA] += std::max(ga, 0.f);
+                coefs[pair.m_chanB] += std::max(gb, 0.f);
+            }
+        }
+
+        float power = 0.f;
+        for (unsigned s=0 ; s<ring->m_count ; ++s)
+            power += coefs[int(ring->m_chans[s])] * coefs[int(ring->m_chans[s])];
+        float norm = power > DistEpsilon ? w / std::sqrt(power) : 0.f;
+        float spread = (1.f - w) / std::sqrt(float(ring->m_count));
+        for (unsigned s=0 ; s<ring->m_count ; ++s)
+        {
+            float& g = coefs[int(ring->m_chans[s])];
+            g = (g * norm + spread) * att;
+        }
+    }
+}
+
+#if __SSE__
+static inline __m128 Dot3(__m128 x, __m128 y, __m128 z, const float v[3])
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(v[0])), _mm_mul_ps(y, _mm_set1_ps(v[1]))),
+                      _mm_mul_ps(z, _mm_set1_ps(v[2])));
+}
+
+/* Four emitters per iteration; gains accumulate in channel-major registers and are
+ * transposed into per-emitter coefficient rows at the end */
+static size_t ComputeGainsSSE(const SpeakerRing* ring, const SpeakerPair* pairs,
+                              const SpatialListener& l, const SpatialEmitterBatch& batch,
+                              size_t count, float (*coefsOut)[8])
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 distEps = _mm_set1_ps(DistEpsilon);
+    const __m128 pairEps = _mm_set1_ps(PairEpsilon);
+    const __m128 minDist = _mm_set1_ps(batch.m_minDistance);
+    const __m128 maxDist = _mm_set1_ps(batch.m_maxDistance);
+    const __m128 lx = _mm_set1_ps(l.m_position[0]);
+    const __m128 ly = _mm_set1_ps(l.m_position[1]);
+    const __m128 lz = _mm_set1_ps(l.m_position[2]);
+    const __m128 invSqrtCount = _mm_set1_ps(ring ? 1.f / std::sqrt(float(ring->m_count)) : 0.f);
+
+    size_t i = 0;
+    for (; i + 4 <= count ; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(batch.m_x + i), lx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(batch.m_y + i), ly);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(batch.m_z + i), lz);
+        __m128 x = Dot3(dx, dy, dz, l.m_right);
+        __m128 y = Dot3(dx, dy, dz, l.m_up);
+        __m128 z = Dot3(dx, dy, dz, l.m_front);
+
+        __m128 h2 = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z));
+        __m128 h = _mm_sqrt_ps(h2);
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(h2, _mm_mul_ps(y, y)));
+        __m128 invH = _mm_and_ps(_mm_cmpgt_ps(h, distEps), _mm_div_ps(one, _mm_max_ps(h, distEps)));
+        __m128 w = _mm_and_ps(_mm_cmpgt_ps(dist, distEps), _mm_div_ps(h, _mm_max_ps(dist, distEps)));
+        x = _mm_mul_ps(x, invH);
+        z = _mm_mul_ps(z, invH);
+
+        __m128 att = _mm_div_ps(minDist, _mm_min_ps(_mm_max_ps(dist, minDist), maxDist));
+        if (batch.m_gains)
+            att = _mm_mul_ps(att, _mm_loadu_ps(batch.m_gains + i));
+
+        __m128 gains[8];
+        for (int c=0 ; c<8 ; ++c)
+            gains[c] = zero;
+
+        if (!ring)
+        {
+            __m128 lat = _mm_mul_ps(x, w);
+            gains[int(AudioChannel::FrontLeft)] =
+                _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_sub_ps(one, lat), half))), att);
+            gains[int(AudioChannel::FrontRight)] =
+                _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_add_ps(one, lat), half))), att);
+        }
+        else
+        {
+            for (unsigned p=0 ; p<ring->m_count ; ++p)
+            {
+                const SpeakerPair& pair = pairs[p];
+                __m128 ga = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(pair.m_a[0])),
+                                       _mm_mul_ps(z, _mm_set1_ps(pair.m_a[1])));
+                __m128 gb = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(pair.m_b[0])),
+                                       _mm_mul_ps(z, _mm_set1_ps(pair.m_b[1])));
+                __m128 inPair = _mm_and_ps(_mm_cmpge_ps(ga, pairEps), _mm_cmpge_ps(gb, pairEps));
+                gains[pair.m_chanA] = _mm_add_ps(gains[pair.m_chanA], _mm_and_ps(inPair, _mm_max_ps(ga, zero)));
+                gains[pair.m_chanB] = _mm_add_ps(gains[pair.m_chanB], _mm_and_ps(inPair, _mm_max_ps(gb, zero)));
+            }
+
+            __m128 power = zero;
+            for (unsigned s=0 ; s<ring->m_count ; ++s)
+            {
+                __m128 g = gains[int(ring->m_chans[s])];
+                power = _mm_add_ps(power, _mm_mul_ps(g, g));
+            }
+            __m128 norm = _mm_and_ps(_mm_cmpgt_ps(power, distEps),
+                                     _mm_div_ps(w, _mm_sqrt_ps(_mm_max_ps(power, distEps))));
+            __m128 spread = _mm_mul_ps(_mm_sub_ps(one, w), invSqrtCount);
+            for (unsigned s=0 ; s<ring->m_count ; ++s)
+            {
+                __m128& g = gains[int(ring->m_chans[s])];
+                g = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(g, norm), spread), att);
+            }
+        }
+
+        _MM_TRANSPOSE4_PS(gains[0], gains[1], gains[2], gains[3]);
+        _MM_TRANSPOSE4_PS(gains[4], gains[5], gains[6], gains[7]);
+        for (int e=0 ; e<4 ; ++e)
+        {
+            _mm_storeu_ps(coefsOut[i + e], gains[e]);
+            _mm_storeu_ps(coefsOut[i + e] + 4, gains[4 + e]);
+        }
+    }
+    return i;
+}
+#endif
+
+void ComputeSpatialGains(AudioChannelSet set, const SpatialListener& listener,
+                         const SpatialEmitterBatch& batch, float (*coefsOut)[8])
+{
+    const SpeakerRing* ring = nullptr;
+    switch (set)
+    {
+    case AudioChannelSet::Quad:
+        ring = &QuadRing;
+        break;
+    case AudioChannelSet::Surround51:
+        ring = &S51Ring;
+        break;
+    case AudioChannelSet::Surround71:
+        ring = &S71Ring;
+        break;
+    default: break;
+    }
+
+    SpeakerPair pairs[7];
+    if (ring)
+        BuildPairs(*ring, pairs);
+
+    size_t done = 0;
+#if __SSE__
+    done = ComputeGainsSSE(ring, pairs, listener, batch, batch.m_count, coefsOut);
+#endif
+    ComputeGainsScalar(ring, pairs, listener, batch, done, batch.m_count, coefsOut + done);
+}
+
+void BaseAudioVoiceEngine::spatializeEmitters(const SpatialListener& listener,
+                                              const SpatialEmitterBatch& batch)
+{
+    /* Bounded stack blocks keep the working set in cache; large batches
+     * spread their blocks across the shared scheduler */
+    static constexpr size_t BlockEmitters = 256;
+    IAudioSubmix* submix = batch.m_submix ? batch.m_submix : &m_mainSubmix;
+
+    /* A voice listed twice could land in two blocks and have its levels written
+     * concurrently; keep only its last entry, matching a serial pass */
+    std::vector<uint8_t> skip;
+    if (batch.m_count > BlockEmitters)
+    {
+        std::vector<size_t> order(batch.m_count);
+        for (size_t i=0 ; i<batch.m_count ; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return std::less<IAudioVoice*>()(batch.m_voices[a], batch.m_voices[b]);
+        });
+        for (size_t i=1 ; i<order.size() ; ++i)
+        {
+            if (batch.m_voices[order[i]] && batch.m_voices[order[i]] == batch.m_voices[order[i-1]])
+            {
+                if (skip.empty())
+                    skip.resize(batch.m_count);
+                skip[order[i-1]] = 1;
+            }
+        }
+    }
+
+    TaskScheduler::Shared().parallelFor(batch.m_count, BlockEmitters,
+    [&](size_t base, size_t end)
+    {
+        float coefs[BlockEmitters][8];
+        SpatialEmitterBatch block = batch;
+        block.m_count = end - base;
+        block.m_x = batch.m_x + base;
+        block.m_y = batch.m_y + base;
+        block.m_z = batch.m_z + base;
+        block.m_gains = batch.m_gains ? batch.m_gains + base : nullptr;
+        ComputeSpatialGains(m_mixInfo.m_channels, listener, block, coefs);
+
+        for (size_t i=0 ; i<block.m_count ; ++i)
+        {
+            if (skip.size() && skip[base + i])
+                continue;
+            if (IAudioVoice* voice = batch.m_voices[base + i])
+                static_cast<AudioVoice*>(voice)->_setMonoSendLevels(submix, coefs[i], batch.m_slew);
+        }
+    }, TaskPriority::High);
+}
+
+}
@@ -329,7 +329,7 @@ void AudioSubmix::setSendLevel(IAudioSubmix* submix, float level, bool slew)
         m_root.m_submixesDirty = true;
     }
 
-    m_slewFrames = slew ? m_root.m_5msFrames : 0;
+    m_slewFrames = slew ? m_root.m_mixQuantumFrames : 0;
     m_curSlewFrame = 0;
 
     search->second[0] = search->second[1];
@@ -27,6 +27,7 @@ class AudioSubmix : public IAudioSubmix
     friend class BaseAudioVoiceEngine;
     friend class AudioVoiceMono;
     friend class AudioVoiceStereo;
+    friend class AudioSampler;
     friend struct WASAPIAudioVoiceEngine;
     friend struct ::AudioUnitVoiceEngine;
     friend struct ::VSTVoiceEngine;
@@ -16,6 +16,7 @@ AudioVoice::AudioVoice(BaseAudioVoiceEngine& root,
 AudioVoice::~AudioVoice()
 {
     unbindVoice();
+    m_root._cancelScheduledEvents(this);
     soxr_delete(m_src);
 }
 
@@ -23,7 +24,7 @@ void AudioVoice::_setPitchRatio(double ratio, bool slew)
 {
     if (m_dynamicRate)
     {
-        soxr_error_t err = soxr_set_io_ratio(m_src, ratio * m_sampleRateIn / m_sampleRateOut, slew ? m_root.m_5msFrames : 0);
+        soxr_error_t err = soxr_set_io_ratio(m_src, ratio * m_sampleRateIn / m_sampleRateOut, slew ? m_root.m_mixQuantumFrames : 0);
         if (err)
         {
             Log.report(logvisor::Fatal, "unable to set resampler rate: %s", soxr_strerror(err));
@@ -69,11 +70,46 @@ void AudioVoice::unbindVoice()
 {
     if (m_bound)
     {
+        m_root._cancelScheduledEvents(this);
         m_root._unbindFrom(m_parentIt);
         m_bound = false;
     }
 }
 
+const char* AudioVoice::getResamplerEngine() const
+{
+    return m_src ? soxr_engine(m_src) : "none";
+}
+
+void AudioVoice::_setMonoSendLevels(IAudioSubmix* submix, const float coefs[8], bool slew)
+{
+    if (submix != m_cachedSend)
+    {
+        setMonoChannelLevels(submix, coefs, slew);
+        return;
+    }
+
+    size_t slewFrames = slew ? m_root.m_mixQuantumFrames : 0;
+    if (m_cachedSendMono)
+    {
+        m_cachedSendMono->setMatrixCoefficients(coefs, slewFrames);
+        return;
+    }
+
+    float newCoefs[8][2] =
+    {
+        {coefs[0], coefs[0]},
+        {coefs[1], coefs[1]},
+        {coefs[2], coefs[2]},
+        {coefs[3], coefs[3]},
+        {coefs[4], coefs[4]},
+        {coefs[5], coefs[5]},
+        {coefs[6], coefs[6]},
+        {coefs[7], coefs[7]}
+    };
+    m_cachedSendStereo->setMatrixCoefficients(newCoefs, slewFrames);
+}
+
 AudioVoiceMono::AudioVoiceMono(BaseAudioVoiceEngine& root, IAudioVoiceCallback* cb,
                                double sampleRate, bool dynamicRate)
 : AudioVoice(root, cb, dynamicRate)
@@ -90,9 +126,11 @@ void AudioVoiceMono::_resetSampleRate(double sampleRate)
     soxr_io_spec_t ioSpec = soxr_io_spec(SOXR_INT16_I, formatOut);
     soxr_quality_spec_t qSpec = soxr_quality_spec(SOXR_20_BITQ, m_dynamicRate ? SOXR_VR : 0);
 
+    soxr_runtime_spec_t rtSpec = m_root._resamplerRuntimeSpec();
+
     soxr_error_t err;
     m_src = soxr_create(sampleRate, rateOut, 1,
-                        &err, &ioSpec, &qSpec, nullptr);
+                        &err, &ioSpec, &qSpec, &rtSpec);
 
     if (err)
     {
@@ -238,6 +276,7 @@ void AudioVoiceMono::resetChannelLevels()
 {
     m_root.m_submixesDirty = true;
     m_sendMatrices.clear();
+    m_cachedSend = nullptr;
 }
 
 void AudioVoiceMono::setMonoChannelLevels(IAudioSubmix* submix, const float coefs[8], bool slew)
@@ -248,7 +287,8 @@ void AudioVoiceMono::setMonoChannelLevels(IAudioSubmix* submix, const float coef
     auto search = m_sendMatrices.find(submix);
     if (search == m_sendMatrices.cend())
         search = m_sendMatrices.emplace(submix, AudioMatrixMono{}).first;
-    search->second.setMatrixCoefficients(coefs, slew ? m_root.m_5msFrames : 0);
+    _cacheSend(submix, search->second);
+    search->second.setMatrixCoefficients(coefs, slew ? m_root.m_mixQuantumFrames : 0);
 }
 
 void AudioVoiceMono::setStereoChannelLevels(IAudioSubmix* submix, const float coefs[8][2], bool slew)
@@ -271,7 +311,8 @@ void AudioVoiceMono::setStereoChannelLevels(IAudioSubmix* submix, const float co
     auto search = m_sendMatrices.find(submix);
     if (search == m_sendMatrices.cend())
         search = m_sendMatrices.emplace(submix, AudioMatrixMono{}).first;
-    search->second.setMatrixCoefficients(newCoefs, slew ? m_root.m_5msFrames : 0);
+    _cacheSend(submix, search->second);
+    search->second.setMatrixCoefficients(newCoefs, slew ? m_root.m_mixQuantumFrames : 0);
 }
 
 AudioVoiceStereo::AudioVoiceStereo(BaseAudioVoiceEngine& root, IAudioVoiceCallback* cb,
@@ -290,9 +331,11 @@ void AudioVoiceStereo::_resetSampleRate(double sampleRate)
     soxr_io_spec_t ioSpec = soxr_io_spec(SOXR_INT16_I, formatOut);
     soxr_quality_spec_t qSpec = soxr_quality_spec(SOXR_20_BITQ, m_dynamicRate ? SOXR_VR : 0);
 
+    soxr_runtime_spec_t rtSpec = m_root._resamplerRuntimeSpec();
+
     soxr_error_t err;
     m_src = soxr_create(sampleRate, rateOut, 2,
-                        &err, &ioSpec, &qSpec, nullptr);
+                        &err, &ioSpec, &qSpec, &rtSpec);
 
     if (!m_src)
     {
@@ -445,6 +488,7 @@ void AudioVoiceStereo::resetChannelLevels()
 {
     m_root.m_submixesDirty = true;
     m_sendMatrices.clear();
+    m_cachedSend = nullptr;
 }
 
 void AudioVoiceStereo::setMonoChannelLevels(IAudioSubmix* submix, const float coefs[8], bool slew)
@@ -467,7 +511,8 @@ void AudioVoiceStereo::setMonoChannelLevels(IAudioSubmix* submix, const float co
     auto search = m_sendMatrices.find(submix);
     if (search == m_sendMatrices.cend())
         search = m_sendMatrices.emplace(submix, AudioMatrixStereo{}).first;
-    search->second.setMatrixCoefficients(newCoefs, slew ? m_root.m_5msFrames : 0);
+    _cacheSend(submix, search->second);
+    search->second.setMatrixCoefficients(newCoefs, slew ? m_root.m_mixQuantumFrames : 0);
 }
 
 void AudioVoiceStereo::setStereoChannelLevels(IAudioSubmix* submix, const float coefs[8][2], bool slew)
@@ -478,7 +523,8 @@ void AudioVoiceStereo::setStereoChannelLevels(IAudioSubmix* submix, const float
     auto search = m_sendMatrices.find(submix);
     if (search == m_sendMatrices.cend())
         search = m_sendMatrices.emplace(submix, AudioMatrixStereo{}).first;
-    search->second.setMatrixCoefficients(coefs, slew ? m_root.m_5msFrames : 0);
+    _cacheSend(submix, search->second);
+    search->second.setMatrixCoefficients(coefs, slew ? m_root.m_mixQuantumFrames : 0);
 }
 
 }
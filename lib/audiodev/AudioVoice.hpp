@@ -63,6 +63,28 @@ protected:
     /* Mid-pump update */
     void _midUpdate();
 
+    /* Last send matrix resolved by set*ChannelLevels(); node pointers into
+     * m_sendMatrices stay valid until resetChannelLevels() clears the cache */
+    IAudioSubmix* m_cachedSend = nullptr;
+    AudioMatrixMono* m_cachedSendMono = nullptr;
+    AudioMatrixStereo* m_cachedSendStereo = nullptr;
+    void _cacheSend(IAudioSubmix* submix, AudioMatrixMono& mtx)
+    {
+        m_cachedSend = submix;
+        m_cachedSendMono = &mtx;
+        m_cachedSendStereo = nullptr;
+    }
+    void _cacheSend(IAudioSubmix* submix, AudioMatrixStereo& mtx)
+    {
+        m_cachedSend = submix;
+        m_cachedSendMono = nullptr;
+        m_cachedSendStereo = &mtx;
+    }
+
+    /* Batch level update (spatializeEmitters); writes the cached matrix directly
+     * and only takes the virtual path when the submix changed. submix is non-null */
+    void _setMonoSendLevels(IAudioSubmix* submix, const float coefs[8], bool slew);
+
     virtual size_t pumpAndMix16(size_t frames)=0;
     virtual size_t pumpAndMix32(size_t frames)=0;
     virtual size_t pumpAndMixFlt(size_t frames)=0;
@@ -76,6 +98,7 @@ public:
     void start();
     void stop();
     void unbindVoice();
+    const char* getResamplerEngine() const;
     double getSampleRateIn() const {return m_sampleRateIn;}
     double getSampleRateOut() const {return m_sampleRateOut;}
 };
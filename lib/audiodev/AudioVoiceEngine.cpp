@@ -1,9 +1,41 @@
 #include "AudioVoiceEngine.hpp"
+#include "AudioSampler.hpp"
+#include "boo/Trace.hpp"
 #include <string.h>
+#include <algorithm>
+
+/* MSVC never defines __SSE__; x64 always has it and /arch:SSE+ sets _M_IX86_FP */
+#if __SSE__ || _M_X64 || (_M_IX86_FP >= 1)
+#define BOO_DENORMAL_CSR 1
+#include <xmmintrin.h>
+#endif
 
 namespace boo
 {
 
+/* Flush denormals to zero (FTZ/DAZ) on the mixing thread for the duration of a pump,
+ * restoring the caller's FP environment afterwards. Decaying reverb tails and filter
+ * state in submix effects otherwise slow the mix by orders of magnitude on fade-out */
+class ScopedDenormalFlush
+{
+#if BOO_DENORMAL_CSR
+    unsigned m_oldCSR;
+public:
+    ScopedDenormalFlush() : m_oldCSR(_mm_getcsr()) {_mm_setcsr(m_oldCSR | 0x8040);}
+    ~ScopedDenormalFlush() {_mm_setcsr(m_oldCSR);}
+#elif __aarch64__
+    uint64_t m_oldFPCR;
+public:
+    ScopedDenormalFlush()
+    {
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(m_oldFPCR));
+        uint64_t fpcr = m_oldFPCR | (uint64_t(1) << 24);
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+    }
+    ~ScopedDenormalFlush() {__asm__ __volatile__("msr fpcr, %0" : : "r"(m_oldFPCR));}
+#endif
+};
+
 BaseAudioVoiceEngine::~BaseAudioVoiceEngine()
 {
     while (m_activeVoices.size())
@@ -14,6 +46,8 @@ BaseAudioVoiceEngine::~BaseAudioVoiceEngine()
 
 void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int16_t* dataOut)
 {
+    BOO_TRACE_ZONE("Audio Pump");
+    ScopedDenormalFlush flushDenormals;
     memset(dataOut, 0, sizeof(int16_t) * frames * m_mixInfo.m_channelMap.m_channelCount);
     m_mainSubmix.m_redirect16 = dataOut;
 
@@ -26,36 +60,42 @@ void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int16_t* dataOut)
     size_t remFrames = frames;
     while (remFrames)
     {
-        size_t thisFrames;
-        if (remFrames < m_5msFrames)
-        {
-            thisFrames = remFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, thisFrames / double(m_5msFrames) * 5.0 / 1000.0);
-        }
-        else
+        size_t thisFrames = std::min(remFrames, m_mixQuantumFrames);
+        if (m_engineCallback)
+            m_engineCallback->onMixQuantum(*this, thisFrames, thisFrames / m_mixInfo.m_sampleRate);
+
+        /* Split quantum at scheduled event boundaries */
+        size_t remQuantumFrames = thisFrames;
+        while (remQuantumFrames)
         {
-            thisFrames = m_5msFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, 5.0 / 1000.0);
+            size_t subFrames = _applyScheduledEvents(remQuantumFrames);
+
+            for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                (*it)->_zeroFill16();
+
+            {
+                BOO_TRACE_ZONE("Audio Voices");
+                for (AudioVoice* vox : m_activeVoices)
+                    if (vox->m_running)
+                        vox->pumpAndMix16(subFrames);
+            }
+
+            {
+                BOO_TRACE_ZONE("Audio Submixes");
+                for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                    (*it)->_pumpAndMix16(subFrames);
+            }
+
+            size_t sampleCount = subFrames * m_mixInfo.m_channelMap.m_channelCount;
+            for (size_t i=0 ; i<sampleCount ; ++i)
+                dataOut[i] *= m_totalVol;
+
+            m_frameClock += subFrames;
+            remQuantumFrames -= subFrames;
+            dataOut += sampleCount;
         }
 
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_zeroFill16();
-
-        for (AudioVoice* vox : m_activeVoices)
-            if (vox->m_running)
-                vox->pumpAndMix16(thisFrames);
-
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_pumpAndMix16(thisFrames);
-
-        size_t sampleCount = thisFrames * m_mixInfo.m_channelMap.m_channelCount;
-        for (size_t i=0 ; i<sampleCount ; ++i)
-            dataOut[i] *= m_totalVol;
-
         remFrames -= thisFrames;
-        dataOut += sampleCount;
     }
 
     if (m_engineCallback)
@@ -64,6 +104,8 @@ void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int16_t* dataOut)
 
 void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int32_t* dataOut)
 {
+    BOO_TRACE_ZONE("Audio Pump");
+    ScopedDenormalFlush flushDenormals;
     memset(dataOut, 0, sizeof(int32_t) * frames * m_mixInfo.m_channelMap.m_channelCount);
     m_mainSubmix.m_redirect32 = dataOut;
 
@@ -76,36 +118,42 @@ void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int32_t* dataOut)
     size_t remFrames = frames;
     while (remFrames)
     {
-        size_t thisFrames;
-        if (remFrames < m_5msFrames)
-        {
-            thisFrames = remFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, thisFrames / double(m_5msFrames) * 5.0 / 1000.0);
-        }
-        else
+        size_t thisFrames = std::min(remFrames, m_mixQuantumFrames);
+        if (m_engineCallback)
+            m_engineCallback->onMixQuantum(*this, thisFrames, thisFrames / m_mixInfo.m_sampleRate);
+
+        /* Split quantum at scheduled event boundaries */
+        size_t remQuantumFrames = thisFrames;
+        while (remQuantumFrames)
         {
-            thisFrames = m_5msFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, 5.0 / 1000.0);
+            size_t subFrames = _applyScheduledEvents(remQuantumFrames);
+
+            for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                (*it)->_zeroFill32();
+
+            {
+                BOO_TRACE_ZONE("Audio Voices");
+                for (AudioVoice* vox : m_activeVoices)
+                    if (vox->m_running)
+                        vox->pumpAndMix32(subFrames);
+            }
+
+            {
+                BOO_TRACE_ZONE("Audio Submixes");
+                for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                    (*it)->_pumpAndMix32(subFrames);
+            }
+
+            size_t sampleCount = subFrames * m_mixInfo.m_channelMap.m_channelCount;
+            for (size_t i=0 ; i<sampleCount ; ++i)
+                dataOut[i] *= m_totalVol;
+
+            m_frameClock += subFrames;
+            remQuantumFrames -= subFrames;
+            dataOut += sampleCount;
         }
 
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_zeroFill32();
-
-        for (AudioVoice* vox : m_activeVoices)
-            if (vox->m_running)
-                vox->pumpAndMix32(thisFrames);
-
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_pumpAndMix32(thisFrames);
-
-        size_t sampleCount = thisFrames * m_mixInfo.m_channelMap.m_channelCount;
-        for (size_t i=0 ; i<sampleCount ; ++i)
-            dataOut[i] *= m_totalVol;
-
         remFrames -= thisFrames;
-        dataOut += sampleCount;
     }
 
     if (m_engineCallback)
@@ -114,6 +162,8 @@ void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, int32_t* dataOut)
 
 void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, float* dataOut)
 {
+    BOO_TRACE_ZONE("Audio Pump");
+    ScopedDenormalFlush flushDenormals;
     memset(dataOut, 0, sizeof(float) * frames * m_mixInfo.m_channelMap.m_channelCount);
     m_mainSubmix.m_redirectFlt = dataOut;
 
@@ -126,36 +176,42 @@ void BaseAudioVoiceEngine::_pumpAndMixVoices(size_t frames, float* dataOut)
     size_t remFrames = frames;
     while (remFrames)
     {
-        size_t thisFrames;
-        if (remFrames < m_5msFrames)
-        {
-            thisFrames = remFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, thisFrames / double(m_5msFrames) * 5.0 / 1000.0);
-        }
-        else
+        size_t thisFrames = std::min(remFrames, m_mixQuantumFrames);
+        if (m_engineCallback)
+            m_engineCallback->onMixQuantum(*this, thisFrames, thisFrames / m_mixInfo.m_sampleRate);
+
+        /* Split quantum at scheduled event boundaries */
+        size_t remQuantumFrames = thisFrames;
+        while (remQuantumFrames)
         {
-            thisFrames = m_5msFrames;
-            if (m_engineCallback)
-                m_engineCallback->on5MsInterval(*this, 5.0 / 1000.0);
+            size_t subFrames = _applyScheduledEvents(remQuantumFrames);
+
+            for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                (*it)->_zeroFillFlt();
+
+            {
+                BOO_TRACE_ZONE("Audio Voices");
+                for (AudioVoice* vox : m_activeVoices)
+                    if (vox->m_running)
+                        vox->pumpAndMixFlt(subFrames);
+            }
+
+            {
+                BOO_TRACE_ZONE("Audio Submixes");
+                for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
+                    (*it)->_pumpAndMixFlt(subFrames);
+            }
+
+            size_t sampleCount = subFrames * m_mixInfo.m_channelMap.m_channelCount;
+            for (size_t i=0 ; i<sampleCount ; ++i)
+                dataOut[i] *= m_totalVol;
+
+            m_frameClock += subFrames;
+            remQuantumFrames -= subFrames;
+            dataOut += sampleCount;
         }
 
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_zeroFillFlt();
-
-        for (AudioVoice* vox : m_activeVoices)
-            if (vox->m_running)
-                vox->pumpAndMixFlt(thisFrames);
-
-        for (auto it = m_linearizedSubmixes.rbegin() ; it != m_linearizedSubmixes.rend() ; ++it)
-            (*it)->_pumpAndMixFlt(thisFrames);
-
-        size_t sampleCount = thisFrames * m_mixInfo.m_channelMap.m_channelCount;
-        for (size_t i=0 ; i<sampleCount ; ++i)
-            dataOut[i] *= m_totalVol;
-
         remFrames -= thisFrames;
-        dataOut += sampleCount;
     }
 
     if (m_engineCallback)
@@ -173,6 +229,202 @@ void BaseAudioVoiceEngine::_unbindFrom(std::list<AudioSubmix*>::iterator it)
     m_submixesDirty = true;
 }
 
+void BaseAudioVoiceEngine::_resetMixQuantum()
+{
+    m_mixQuantumFrames = m_requestedQuantumFrames ? m_requestedQuantumFrames : m_5msFrames;
+}
+
+soxr_runtime_spec_t BaseAudioVoiceEngine::_resamplerRuntimeSpec() const
+{
+    soxr_runtime_spec_t spec = soxr_runtime_spec(m_resamplerConfig.m_threads);
+    spec.log2_min_dft_size = m_resamplerConfig.m_log2MinDFTSize;
+    spec.log2_large_dft_size = m_resamplerConfig.m_log2LargeDFTSize;
+    spec.coef_size_kbytes = m_resamplerConfig.m_coefSizeKBytes;
+    switch (m_resamplerConfig.m_coefInterp)
+    {
+    case AudioResamplerConfig::CoefInterpolation::Low:
+        spec.flags = SOXR_COEF_INTERP_LOW;
+        break;
+    case AudioResamplerConfig::CoefInterpolation::High:
+        spec.flags = SOXR_COEF_INTERP_HIGH;
+        break;
+    default:
+        spec.flags = SOXR_COEF_INTERP_AUTO;
+        break;
+    }
+    if (!m_resamplerConfig.m_useSIMD)
+        spec.flags |= SOXR_NO_SIMD;
+    return spec;
+}
+
+void BaseAudioVoiceEngine::setMixQuantumFrames(size_t frames)
+{
+    m_requestedQuantumFrames = frames;
+    _resetMixQuantum();
+}
+
+void BaseAudioVoiceEngine::_scheduleEvent(const ScheduledVoiceEvent& ev)
+{
+    /* Unbound voices never reach the mixer; nothing would cancel the event */
+    if (!ev.m_voice->m_bound)
+        return;
+    auto it = std::lower_bound(m_scheduledEvents.begin(), m_scheduledEvents.end(), ev,
+    [](const ScheduledVoiceEvent& a, const ScheduledVoiceEvent& b) { return a.m_frame > b.m_frame; });
+    m_scheduledEvents.insert(it, ev);
+}
+
+void BaseAudioVoiceEngine::_cancelScheduledEvents(AudioVoice* voice)
+{
+    m_scheduledEvents.erase(std::remove_if(m_scheduledEvents.begin(), m_scheduledEvents.end(),
+    [voice](const ScheduledVoiceEvent& ev) { return ev.m_voice == voice; }), m_scheduledEvents.end());
+}
+
+size_t BaseAudioVoiceEngine::_dispatchSequenceEvents(size_t maxFrames)
+{
+    bool swept = false;
+    for (size_t i=0 ; i<m_sequencePlaybacks.size() ; ++i)
+    {
+        while (m_sequencePlaybacks[i].m_reader)
+        {
+            /* Readers may start or stop sequences from within dispatch; re-fetch each event */
+            MIDISequencePlayback& pb = m_sequencePlaybacks[i];
+            const std::vector<MIDISequence::Event>& events = pb.m_seq->events();
+            if (pb.m_cursor == events.size())
+            {
+                pb.m_reader = nullptr;
+                break;
+            }
+
+            const MIDISequence::Event& ev = events[pb.m_cursor];
+            uint64_t frame = pb.m_startFrame + uint64_t(ev.m_time * m_mixInfo.m_sampleRate + 0.5);
+            if (frame > m_frameClock)
+            {
+                maxFrames = std::min(maxFrames, size_t(frame - m_frameClock));
+                break;
+            }
+
+            ++pb.m_cursor;
+            MIDISequence* seq = pb.m_seq.get();
+            seq->dispatch(ev, *pb.m_reader);
+        }
+        if (!m_sequencePlaybacks[i].m_reader)
+            swept = true;
+    }
+
+    if (swept)
+        m_sequencePlaybacks.erase(std::remove_if(m_sequencePlaybacks.begin(), m_sequencePlaybacks.end(),
+        [](const MIDISequencePlayback& pb) { return pb.m_reader == nullptr; }), m_sequencePlaybacks.end());
+
+    return maxFrames;
+}
+
+size_t BaseAudioVoiceEngine::_applyScheduledEvents(size_t maxFrames)
+{
+    /* Sequencer events go first so readers may schedule voice events for this same frame */
+    if (m_sequencePlaybacks.size())
+        maxFrames = _dispatchSequenceEvents(maxFrames);
+
+    while (m_scheduledEvents.size() && m_scheduledEvents.back().m_frame <= m_frameClock)
+    {
+        const ScheduledVoiceEvent& ev = m_scheduledEvents.back();
+        switch (ev.m_type)
+        {
+        case ScheduledVoiceEvent::Type::Start:
+            ev.m_voice->start();
+            break;
+        case ScheduledVoiceEvent::Type::Stop:
+            ev.m_voice->stop();
+            break;
+        case ScheduledVoiceEvent::Type::PitchRatio:
+            ev.m_voice->m_pitchRatio = ev.m_pitchRatio;
+            ev.m_voice->_setPitchRatio(ev.m_pitchRatio, false);
+            break;
+        case ScheduledVoiceEvent::Type::MonoChannelLevels:
+            ev.m_voice->setMonoChannelLevels(ev.m_submix, ev.m_monoCoefs, false);
+            break;
+        case ScheduledVoiceEvent::Type::StereoChannelLevels:
+            ev.m_voice->setStereoChannelLevels(ev.m_submix, ev.m_stereoCoefs, false);
+            break;
+        }
+        m_scheduledEvents.pop_back();
+    }
+
+    if (m_scheduledEvents.size())
+        return std::min(maxFrames, size_t(m_scheduledEvents.back().m_frame - m_frameClock));
+    return maxFrames;
+}
+
+void BaseAudioVoiceEngine::scheduleStart(IAudioVoice* voice, uint64_t frame)
+{
+    ScheduledVoiceEvent ev;
+    ev.m_type = ScheduledVoiceEvent::Type::Start;
+    ev.m_frame = frame;
+    ev.m_voice = static_cast<AudioVoice*>(voice);
+    _scheduleEvent(ev);
+}
+
+void BaseAudioVoiceEngine::scheduleStop(IAudioVoice* voice, uint64_t frame)
+{
+    ScheduledVoiceEvent ev;
+    ev.m_type = ScheduledVoiceEvent::Type::Stop;
+    ev.m_frame = frame;
+    ev.m_voice = static_cast<AudioVoice*>(voice);
+    _scheduleEvent(ev);
+}
+
+void BaseAudioVoiceEngine::schedulePitchRatio(IAudioVoice* voice, uint64_t frame, double ratio)
+{
+    ScheduledVoiceEvent ev;
+    ev.m_type = ScheduledVoiceEvent::Type::PitchRatio;
+    ev.m_frame = frame;
+    ev.m_voice = static_cast<AudioVoice*>(voice);
+    ev.m_pitchRatio = ratio;
+    _scheduleEvent(ev);
+}
+
+void BaseAudioVoiceEngine::scheduleMonoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                                     IAudioSubmix* submix, const float coefs[8])
+{
+    ScheduledVoiceEvent ev;
+    ev.m_type = ScheduledVoiceEvent::Type::MonoChannelLevels;
+    ev.m_frame = frame;
+    ev.m_voice = static_cast<AudioVoice*>(voice);
+    ev.m_submix = submix;
+    memmove(ev.m_monoCoefs, coefs, sizeof(ev.m_monoCoefs));
+    _scheduleEvent(ev);
+}
+
+void BaseAudioVoiceEngine::scheduleStereoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                                       IAudioSubmix* submix, const float coefs[8][2])
+{
+    ScheduledVoiceEvent ev;
+    ev.m_type = ScheduledVoiceEvent::Type::StereoChannelLevels;
+    ev.m_frame = frame;
+    ev.m_voice = static_cast<AudioVoice*>(voice);
+    ev.m_submix = submix;
+    memmove(ev.m_stereoCoefs, coefs, sizeof(ev.m_stereoCoefs));
+    _scheduleEvent(ev);
+}
+
+void BaseAudioVoiceEngine::playMIDISequence(const std::shared_ptr<MIDISequence>& seq,
+                                            IMIDIReader* reader, uint64_t startFrame)
+{
+    if (!seq || !reader)
+        return;
+    MIDISequencePlayback pb;
+    pb.m_seq = seq;
+    pb.m_reader = reader;
+    pb.m_startFrame = startFrame;
+    m_sequencePlaybacks.push_back(std::move(pb));
+}
+
+void BaseAudioVoiceEngine::stopMIDISequences(IMIDIReader* reader)
+{
+    for (MIDISequencePlayback& pb : m_sequencePlaybacks)
+        if (pb.m_reader == reader)
+            pb.m_reader = nullptr;
+}
+
 std::unique_ptr<IAudioVoice>
 BaseAudioVoiceEngine::allocateNewMonoVoice(double sampleRate,
                                            IAudioVoiceCallback* cb,
@@ -197,6 +449,15 @@ BaseAudioVoiceEngine::allocateNewStereoVoice(double sampleRate,
     return ret;
 }
 
+std::unique_ptr<IAudioSampler>
+BaseAudioVoiceEngine::allocateNewSampler(size_t polyphony, IAudioVoiceCallback* cb)
+{
+    std::unique_ptr<IAudioSampler> ret = std::make_unique<AudioSampler>(*this, cb, polyphony);
+    AudioSampler* retSampler = static_cast<AudioSampler*>(ret.get());
+    retSampler->bindVoice(m_activeVoices.insert(m_activeVoices.end(), retSampler));
+    return ret;
+}
+
 std::unique_ptr<IAudioSubmix>
 BaseAudioVoiceEngine::allocateNewSubmix(bool mainOut, IAudioSubmixCallback* cb, int busId)
 {
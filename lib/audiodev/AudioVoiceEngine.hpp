@@ -2,6 +2,8 @@
 #define BOO_AUDIOVOICEENGINE_HPP
 
 #include "boo/audiodev/IAudioVoiceEngine.hpp"
+#include "boo/audiodev/MIDISequence.hpp"
+#include "boo/audiodev/AudioSpatializer.hpp"
 #include "AudioVoice.hpp"
 #include "AudioSubmix.hpp"
 #include <functional>
@@ -20,6 +22,38 @@ struct AudioVoiceEngineMixInfo
     size_t m_periodFrames;
 };
 
+/** Voice state change deferred to an exact output frame */
+struct ScheduledVoiceEvent
+{
+    enum class Type
+    {
+        Start,
+        Stop,
+        PitchRatio,
+        MonoChannelLevels,
+        StereoChannelLevels
+    };
+    Type m_type;
+    uint64_t m_frame;
+    AudioVoice* m_voice;
+    IAudioSubmix* m_submix = nullptr;
+    double m_pitchRatio = 1.0;
+    union
+    {
+        float m_monoCoefs[8];
+        float m_stereoCoefs[8][2];
+    };
+};
+
+/** Cursor of a MIDISequence being played into a reader */
+struct MIDISequencePlayback
+{
+    std::shared_ptr<MIDISequence> m_seq;
+    IMIDIReader* m_reader;
+    uint64_t m_startFrame;
+    size_t m_cursor = 0;
+};
+
 /** Base class for managing mixing and sample-rate-conversion amongst active voices */
 class BaseAudioVoiceEngine : public IAudioVoiceEngine
 {
@@ -28,13 +62,24 @@ protected:
     friend class AudioSubmix;
     friend class AudioVoiceMono;
     friend class AudioVoiceStereo;
+    friend class AudioSampler;
     float m_totalVol = 1.f;
     AudioVoiceEngineMixInfo m_mixInfo;
     std::list<AudioVoice*> m_activeVoices;
     std::list<AudioSubmix*> m_activeSubmixes;
     size_t m_5msFrames = 0;
+    size_t m_mixQuantumFrames = 0;
+    size_t m_requestedQuantumFrames = 0;
+    AudioResamplerConfig m_resamplerConfig;
+    uint64_t m_frameClock = 0;
     IAudioVoiceEngineCallback* m_engineCallback = nullptr;
 
+    /* Pending voice events; kept in descending frame order so due events pop from the back */
+    std::vector<ScheduledVoiceEvent> m_scheduledEvents;
+
+    /* Active sequencer cursors; stopped entries have a null reader until swept */
+    std::vector<MIDISequencePlayback> m_sequencePlaybacks;
+
     /* Shared scratch buffers for accumulating audio data for resampling */
     std::vector<int16_t> m_scratchIn;
     std::vector<int16_t> m_scratch16Pre;
@@ -55,8 +100,20 @@ protected:
     void _unbindFrom(std::list<AudioVoice*>::iterator it);
     void _unbindFrom(std::list<AudioSubmix*>::iterator it);
 
+    /* Backends call this once m_5msFrames is established for the output sample-rate */
+    void _resetMixQuantum();
+
+    soxr_runtime_spec_t _resamplerRuntimeSpec() const;
+
+    void _scheduleEvent(const ScheduledVoiceEvent& ev);
+    void _cancelScheduledEvents(AudioVoice* voice);
+
+    /* Apply events due at the current frame clock; returns frames to mix before the next one */
+    size_t _applyScheduledEvents(size_t maxFrames);
+    size_t _dispatchSequenceEvents(size_t maxFrames);
+
 public:
-    BaseAudioVoiceEngine() : m_mainSubmix(*this, nullptr, -1, false) {}
+    BaseAudioVoiceEngine() : m_mainSubmix(*this, nullptr, -1, false) {m_scheduledEvents.reserve(64);}
     ~BaseAudioVoiceEngine();
     std::unique_ptr<IAudioVoice> allocateNewMonoVoice(double sampleRate,
                                                       IAudioVoiceCallback* cb,
@@ -68,6 +125,8 @@ public:
 
     std::unique_ptr<IAudioSubmix> allocateNewSubmix(bool mainOut, IAudioSubmixCallback* cb, int busId);
 
+    std::unique_ptr<IAudioSampler> allocateNewSampler(size_t polyphony, IAudioVoiceCallback* cb=nullptr);
+
     void setCallbackInterface(IAudioVoiceEngineCallback* cb);
 
     void setVolume(float vol);
@@ -75,6 +134,25 @@ public:
     AudioChannelSet getAvailableSet() {return m_mixInfo.m_channels;}
     void pumpAndMixVoices() {}
     size_t get5MsFrames() const {return m_5msFrames;}
+    void setMixQuantumFrames(size_t frames);
+    size_t getMixQuantumFrames() const {return m_mixQuantumFrames;}
+    void setResamplerConfig(const AudioResamplerConfig& config) {m_resamplerConfig = config;}
+    const AudioResamplerConfig& getResamplerConfig() const {return m_resamplerConfig;}
+
+    uint64_t getFrameClock() const {return m_frameClock;}
+    void scheduleStart(IAudioVoice* voice, uint64_t frame);
+    void scheduleStop(IAudioVoice* voice, uint64_t frame);
+    void schedulePitchRatio(IAudioVoice* voice, uint64_t frame, double ratio);
+    void scheduleMonoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                   IAudioSubmix* submix, const float coefs[8]);
+    void scheduleStereoChannelLevels(IAudioVoice* voice, uint64_t frame,
+                                     IAudioSubmix* submix, const float coefs[8][2]);
+
+    void playMIDISequence(const std::shared_ptr<MIDISequence>& seq,
+                          IMIDIReader* reader, uint64_t startFrame);
+    void stopMIDISequences(IMIDIReader* reader);
+
+    void spatializeEmitters(const SpatialListener& listener, const SpatialEmitterBatch& batch);
 };
 
 }
@@ -1,5 +1,6 @@
 #include "MIDICommon.hpp"
 #include "boo/audiodev/IMIDIPort.hpp"
+#include "boo/audiodev/IMIDIReader.hpp"
 
 namespace boo
 {
@@ -9,4 +10,65 @@ IMIDIIn::~IMIDIIn() {}
 IMIDIOut::~IMIDIOut() {}
 IMIDIInOut::~IMIDIInOut() {}
 
+/* Dispatch tables shared by decoders and sequencers; channel messages are indexed by
+ * the status high nibble (0x8-0xE), system messages by the low nibble of 0xFn */
+using ChannelDispatchFunc = void(*)(IMIDIReader& out, uint8_t chan, const uint8_t* data);
+using SystemDispatchFunc = void(*)(IMIDIReader& out, const uint8_t* data);
+
+static void DispatchNoteOff(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.noteOff(chan, data[0], data[1]);}
+static void DispatchNoteOn(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.noteOn(chan, data[0], data[1]);}
+static void DispatchNotePressure(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.notePressure(chan, data[0], data[1]);}
+static void DispatchControlChange(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.controlChange(chan, data[0], data[1]);}
+static void DispatchProgramChange(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.programChange(chan, data[0]);}
+static void DispatchChannelPressure(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.channelPressure(chan, data[0]);}
+static void DispatchPitchBend(IMIDIReader& out, uint8_t chan, const uint8_t* data)
+{out.pitchBend(chan, data[1] * 128 + data[0]);}
+
+static void DispatchTimecode(IMIDIReader& out, const uint8_t* data)
+{out.timeCodeQuarterFrame(data[0] >> 4 & 0x7, data[0] & 0xf);}
+static void DispatchSongPosition(IMIDIReader& out, const uint8_t* data)
+{out.songPositionPointer(data[1] * 128 + data[0]);}
+static void DispatchSongSelect(IMIDIReader& out, const uint8_t* data)
+{out.songSelect(data[0]);}
+static void DispatchTuneRequest(IMIDIReader& out, const uint8_t*) {out.tuneRequest();}
+static void DispatchStart(IMIDIReader& out, const uint8_t*) {out.startSeq();}
+static void DispatchContinue(IMIDIReader& out, const uint8_t*) {out.continueSeq();}
+static void DispatchStop(IMIDIReader& out, const uint8_t*) {out.stopSeq();}
+static void DispatchReset(IMIDIReader& out, const uint8_t*) {out.reset();}
+
+static const uint8_t ChannelDataLen[8] = {2, 2, 2, 2, 1, 1, 2, 0};
+static const ChannelDispatchFunc ChannelDispatch[8] =
+{
+    DispatchNoteOff, DispatchNoteOn, DispatchNotePressure, DispatchControlChange,
+    DispatchProgramChange, DispatchChannelPressure, DispatchPitchBend, nullptr
+};
+
+static const uint8_t SystemDataLen[16] = {0, 1, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const SystemDispatchFunc SystemDispatch[16] =
+{
+    nullptr, DispatchTimecode, DispatchSongPosition, DispatchSongSelect,
+    nullptr, nullptr, DispatchTuneRequest, nullptr,
+    nullptr, nullptr, DispatchStart, DispatchContinue,
+    DispatchStop, nullptr, nullptr, DispatchReset
+};
+
+uint8_t StatusDataLen(uint8_t status)
+{
+    return status < 0xF0 ? ChannelDataLen[status >> 4 & 0x7] : SystemDataLen[status & 0xf];
+}
+
+void DispatchStatus(IMIDIReader& out, uint8_t status, const uint8_t* data)
+{
+    if (status < 0xF0)
+        ChannelDispatch[status >> 4 & 0x7](out, status & 0xf, data);
+    else if (SystemDispatch[status & 0xf])
+        SystemDispatch[status & 0xf](out, data);
+}
+
 }
@@ -1,8 +1,11 @@
 #ifndef BOO_MIDICOMMON_HPP
 #define BOO_MIDICOMMON_HPP
 
+#include <stdint.h>
+
 namespace boo
 {
+class IMIDIReader;
 
 enum class Status
 {
@@ -27,6 +30,12 @@ enum class Status
     Reset = 0xFF,
 };
 
+/** Count of data bytes following a (non-SysEx) status byte */
+uint8_t StatusDataLen(uint8_t status);
+
+/** Invoke the IMIDIReader method for a complete message via table lookup */
+void DispatchStatus(IMIDIReader& out, uint8_t status, const uint8_t* data);
+
 }
 
 #endif // BOO_MIDICOMMON_HPP
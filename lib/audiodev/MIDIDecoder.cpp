@@ -53,13 +53,15 @@ MIDIDecoder::receiveBytes(std::vector<uint8_t>::const_iterator begin,
 
     if (m_status == 0xff)
     {
-        /* Meta events (ignored for now) */
+        /* Meta events */
         if (it == end)
             return begin;
         a = *it++;
 
         uint32_t length;
-        _readContinuedValue(it, end, length);
+        if (it == end || !_readContinuedValue(it, end, length) || end - it < length)
+            return begin;
+        m_out.metaEvent(a, length ? &*it : nullptr, length);
         it += length;
     }
     else
@@ -206,4 +208,96 @@ MIDIDecoder::receiveBytes(std::vector<uint8_t>::const_iterator begin,
     return it;
 }
 
+void MIDIDecoder::_sysExData(const uint8_t* data, size_t len, bool last)
+{
+    if (m_out.streamsSysEx())
+    {
+        if (!len && !last)
+            return;
+        m_out.sysexChunk(data, len, m_sysExFirst, last);
+        m_sysExFirst = false;
+    }
+    else
+    {
+        m_sysExBuf.insert(m_sysExBuf.end(), data, data + len);
+        if (last)
+        {
+            m_out.sysex(m_sysExBuf.data(), m_sysExBuf.size());
+            m_sysExBuf.clear();
+        }
+    }
+}
+
+void MIDIDecoder::receiveBytes(const uint8_t* data, size_t len)
+{
+    const uint8_t* end = data + len;
+    const uint8_t* sysExBegin = data;
+
+    for (const uint8_t* it = data ; it != end ; ++it)
+    {
+        uint8_t a = *it;
+
+        if (a < 0x80)
+        {
+            /* Data byte; SysEx payload is forwarded in runs rather than per-byte */
+            if (m_inSysEx || !m_status)
+                continue;
+            m_data[m_dataCount++] = a;
+            if (m_dataCount == StatusDataLen(m_status))
+            {
+                DispatchStatus(m_out, m_status, m_data);
+                m_dataCount = 0;
+                /* Only channel messages establish running status */
+                if (m_status >= 0xF0)
+                    m_status = 0;
+            }
+            continue;
+        }
+
+        if (a >= 0xF8)
+        {
+            /* Real-time messages may appear anywhere, even inside SysEx */
+            if (m_inSysEx)
+            {
+                _sysExData(sysExBegin, it - sysExBegin, false);
+                sysExBegin = it + 1;
+            }
+            DispatchStatus(m_out, a, nullptr);
+            continue;
+        }
+
+        /* Any other status byte terminates SysEx */
+        if (m_inSysEx)
+        {
+            _sysExData(sysExBegin, it - sysExBegin, true);
+            m_inSysEx = false;
+        }
+
+        m_dataCount = 0;
+        if (a == uint8_t(Status::SysEx))
+        {
+            m_inSysEx = true;
+            m_sysExFirst = true;
+            sysExBegin = it + 1;
+            m_status = 0;
+        }
+        else if (a == uint8_t(Status::SysExTerm))
+        {
+            m_status = 0;
+        }
+        else
+        {
+            m_status = a;
+            if (!StatusDataLen(a))
+            {
+                DispatchStatus(m_out, a, nullptr);
+                m_status = 0;
+            }
+        }
+    }
+
+    if (m_inSysEx)
+        _sysExData(sysExBegin, end - sysExBegin, false);
+}
+
 }
@@ -1,4 +1,5 @@
 #include "boo/audiodev/MIDIEncoder.hpp"
+#include "boo/audiodev/MIDIOutQueue.hpp"
 #include "MIDICommon.hpp"
 
 namespace boo
@@ -224,5 +225,6 @@ void MIDIEncoder<Sender>::reset()
 
 template class MIDIEncoder<IMIDIOut>;
 template class MIDIEncoder<IMIDIInOut>;
+template class MIDIEncoder<MIDIOutQueue>;
 
 }
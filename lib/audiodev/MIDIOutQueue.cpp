@@ -0,0 +1,213 @@
+#include "boo/audiodev/MIDIOutQueue.hpp"
+#include "MIDICommon.hpp"
+#include <algorithm>
+
+namespace boo
+{
+
+MIDIOutQueue::MIDIOutQueue(IMIDIOut& out)
+: m_sink([&out](const void* buf, size_t len) { return out.send(buf, len); })
+{
+    m_partial.reserve(256);
+    m_thread = std::thread(std::bind(&MIDIOutQueue::_proc, this));
+}
+
+MIDIOutQueue::MIDIOutQueue(IMIDIInOut& out)
+: m_sink([&out](const void* buf, size_t len) { return out.send(buf, len); })
+{
+    m_partial.reserve(256);
+    m_thread = std::thread(std::bind(&MIDIOutQueue::_proc, this));
+}
+
+MIDIOutQueue::~MIDIOutQueue()
+{
+    {
+        std::unique_lock<std::mutex> lk(m_lock);
+        m_running = false;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void MIDIOutQueue::_finishMessage(const uint8_t* data, size_t len, Clock::time_point time)
+{
+    Message msg = {time, uint32_t(m_bytes.size()), uint32_t(len)};
+    m_bytes.insert(m_bytes.end(), data, data + len);
+
+    /* Usually appends; equal timestamps keep submission order */
+    auto it = std::upper_bound(m_messages.begin(), m_messages.end(), msg,
+    [](const Message& a, const Message& b) { return a.m_time < b.m_time; });
+    if (it == m_messages.begin())
+        m_wakePending = true;
+    m_messages.insert(it, msg);
+}
+
+void MIDIOutQueue::_wakeIfNeeded()
+{
+    if (m_wakePending && !m_batchDepth)
+    {
+        m_wakePending = false;
+        m_cv.notify_one();
+    }
+}
+
+void MIDIOutQueue::_finishPartial(Clock::time_point time)
+{
+    _finishMessage(m_partial.data(), m_partial.size(), time);
+    m_partial.clear();
+}
+
+void MIDIOutQueue::_enqueue(const uint8_t* data, size_t len, Clock::time_point time)
+{
+    for (size_t i=0 ; i<len ; ++i)
+    {
+        uint8_t a = data[i];
+
+        if (m_inSysEx)
+        {
+            m_partial.push_back(a);
+            if (a == uint8_t(Status::SysExTerm))
+            {
+                m_inSysEx = false;
+                _finishPartial(time);
+            }
+            continue;
+        }
+
+        if (a >= 0xF8)
+        {
+            /* Real-time bytes stand alone and may interrupt a partial message */
+            _finishMessage(&a, 1, time);
+            continue;
+        }
+
+        if (a & 0x80)
+        {
+            m_partial.clear();
+            m_partial.push_back(a);
+            if (a == uint8_t(Status::SysEx))
+            {
+                m_inSysEx = true;
+                m_inStatus = 0;
+            }
+            else
+            {
+                m_inStatus = a < 0xF0 ? a : 0;
+                if (!StatusDataLen(a))
+                    _finishPartial(time);
+            }
+            continue;
+        }
+
+        /* Data byte; expand running status into a whole message */
+        if (m_partial.empty())
+        {
+            if (!m_inStatus)
+                continue;
+            m_partial.push_back(m_inStatus);
+        }
+        m_partial.push_back(a);
+        if (m_partial.size() == size_t(StatusDataLen(m_partial[0])) + 1)
+            _finishPartial(time);
+    }
+}
+
+void MIDIOutQueue::setSendTime(Clock::time_point time)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_sendTime = time;
+}
+
+size_t MIDIOutQueue::send(const void* buf, size_t len)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    _enqueue(static_cast<const uint8_t*>(buf), len, m_sendTime);
+    _wakeIfNeeded();
+    return len;
+}
+
+void MIDIOutQueue::sendAt(Clock::time_point time, const void* buf, size_t len)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    _enqueue(static_cast<const uint8_t*>(buf), len, time);
+    _wakeIfNeeded();
+}
+
+void MIDIOutQueue::beginBatch()
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    ++m_batchDepth;
+}
+
+void MIDIOutQueue::endBatch()
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    /* The output thread ignores deadlines while held, so always wake it on release */
+    if (m_batchDepth && !--m_batchDepth)
+        m_wakePending = true;
+    _wakeIfNeeded();
+}
+
+void MIDIOutQueue::_flushDue(std::unique_lock<std::mutex>& lk, bool all)
+{
+    Clock::time_point now = Clock::now();
+    auto endIt = m_messages.begin();
+    m_writeBuf.clear();
+    for (; endIt != m_messages.end() && (all || endIt->m_time <= now) ; ++endIt)
+    {
+        const uint8_t* msg = &m_bytes[endIt->m_offset];
+        uint8_t status = msg[0];
+        if (status < 0xF0)
+        {
+            /* Running status: omit status byte repeated from previous channel message */
+            if (status == m_outStatus)
+                m_writeBuf.insert(m_writeBuf.end(), msg + 1, msg + endIt->m_len);
+            else
+                m_writeBuf.insert(m_writeBuf.end(), msg, msg + endIt->m_len);
+            m_outStatus = status;
+        }
+        else
+        {
+            m_writeBuf.insert(m_writeBuf.end(), msg, msg + endIt->m_len);
+            if (status < 0xF8)
+                m_outStatus = 0;
+        }
+    }
+
+    if (endIt == m_messages.begin())
+        return;
+
+    /* Compact remaining (future) messages */
+    m_messages.erase(m_messages.begin(), endIt);
+    m_spareBytes.clear();
+    for (Message& msg : m_messages)
+    {
+        uint32_t newOffset = uint32_t(m_spareBytes.size());
+        m_spareBytes.insert(m_spareBytes.end(), m_bytes.cbegin() + msg.m_offset,
+                            m_bytes.cbegin() + msg.m_offset + msg.m_len);
+        msg.m_offset = newOffset;
+    }
+    m_bytes.swap(m_spareBytes);
+
+    lk.unlock();
+    m_sink(m_writeBuf.data(), m_writeBuf.size());
+    lk.lock();
+}
+
+void MIDIOutQueue::_proc()
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    while (m_running)
+    {
+        if (m_messages.empty() || m_batchDepth)
+            m_cv.wait(lk);
+        else if (m_messages.front().m_time > Clock::now())
+            m_cv.wait_until(lk, m_messages.front().m_time);
+        else
+            _flushDue(lk, false);
+    }
+    _flushDue(lk, true);
+}
+
+}
@@ -0,0 +1,277 @@
+#include "boo/audiodev/MIDISequence.hpp"
+#include "MIDICommon.hpp"
+#include "logvisor/logvisor.hpp"
+#include <algorithm>
+#include <string.h>
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace boo
+{
+static logvisor::Module Log("boo::MIDISequence");
+
+static inline uint32_t ReadBE32(const uint8_t* d)
+{
+    return uint32_t(d[0]) << 24 | uint32_t(d[1]) << 16 | uint32_t(d[2]) << 8 | d[3];
+}
+
+static inline uint16_t ReadBE16(const uint8_t* d)
+{
+    return uint16_t(d[0] << 8 | d[1]);
+}
+
+static bool ReadVarLen(const uint8_t*& it, const uint8_t* end, uint32_t& valOut)
+{
+    valOut = 0;
+    for (int i=0 ; i<4 ; ++i)
+    {
+        if (it == end)
+            return false;
+        uint8_t a = *it++;
+        valOut = valOut << 7 | (a & 0x7f);
+        if (!(a & 0x80))
+            return true;
+    }
+    return false;
+}
+
+namespace
+{
+struct TickEvent
+{
+    uint64_t m_tick;
+    MIDISequence::Event m_ev;
+};
+}
+
+MIDISequence::MIDISequence(const uint8_t* data, size_t len)
+{
+    if (len < 14 || memcmp(data, "MThd", 4) || ReadBE32(data + 4) < 6)
+    {
+        Log.report(logvisor::Error, "not a Standard MIDI File");
+        return;
+    }
+
+    uint16_t format = ReadBE16(data + 8);
+    uint16_t division = ReadBE16(data + 12);
+    if (format > 1)
+    {
+        Log.report(logvisor::Error, "unsupported SMF format %d", int(format));
+        return;
+    }
+
+    const uint8_t* end = data + len;
+    const uint8_t* chunk = data + 8 + ReadBE32(data + 4);
+    std::vector<TickEvent> tickEvents;
+
+    /* Decode each track into absolute-tick events; concatenating track-by-track
+     * lets a stable sort merge simultaneous events in track order */
+    while (end - chunk >= 8)
+    {
+        uint32_t chunkLen = ReadBE32(chunk + 4);
+        const uint8_t* it = chunk + 8;
+        const uint8_t* trackEnd = size_t(end - it) < chunkLen ? end : it + chunkLen;
+        bool isTrack = !memcmp(chunk, "MTrk", 4);
+        chunk = trackEnd;
+        if (!isTrack)
+            continue;
+
+        uint64_t tick = 0;
+        uint8_t status = 0;
+        while (it < trackEnd)
+        {
+            uint32_t delta;
+            if (!ReadVarLen(it, trackEnd, delta) || it == trackEnd)
+                break;
+            tick += delta;
+
+            TickEvent te = {};
+            te.m_tick = tick;
+            if (*it & 0x80)
+                status = *it++;
+
+            if (status == 0xFF)
+            {
+                /* Meta event; cancels running status */
+                status = 0;
+                uint32_t metaLen;
+                if (it == trackEnd)
+                    break;
+                uint8_t type = *it++;
+                if (!ReadVarLen(it, trackEnd, metaLen) || uint32_t(trackEnd - it) < metaLen)
+                    break;
+                if (type == 0x2F)
+                    break;
+                te.m_ev.m_status = 0xFF;
+                te.m_ev.m_data[0] = type;
+                te.m_ev.m_payloadOffset = uint32_t(m_payload.size());
+                te.m_ev.m_payloadLen = metaLen;
+                m_payload.insert(m_payload.end(), it, it + metaLen);
+                it += metaLen;
+            }
+            else if (status == 0xF0 || status == 0xF7)
+            {
+                /* Length-prefixed SysEx (or escaped bytes); cancels running status */
+                bool escape = status == 0xF7;
+                status = 0;
+                uint32_t sysexLen;
+                if (!ReadVarLen(it, trackEnd, sysexLen) || uint32_t(trackEnd - it) < sysexLen)
+                    break;
+                const uint8_t* payload = it;
+                it += sysexLen;
+                if (escape)
+                    continue;
+                if (sysexLen && payload[sysexLen - 1] == 0xF7)
+                    --sysexLen;
+                te.m_ev.m_status = 0xF0;
+                te.m_ev.m_payloadOffset = uint32_t(m_payload.size());
+                te.m_ev.m_payloadLen = sysexLen;
+                m_payload.insert(m_payload.end(), payload, payload + sysexLen);
+            }
+            else if (status & 0x80)
+            {
+                uint8_t dataLen = StatusDataLen(status);
+                if (uint32_t(trackEnd - it) < dataLen)
+                    break;
+                te.m_ev.m_status = status;
+                for (uint8_t i=0 ; i<dataLen ; ++i)
+                    te.m_ev.m_data[i] = *it++ & 0x7f;
+            }
+            else
+            {
+                Log.report(logvisor::Error, "data byte without running status in SMF track");
+                break;
+            }
+
+            tickEvents.push_back(te);
+        }
+    }
+
+    std::stable_sort(tickEvents.begin(), tickEvents.end(),
+    [](const TickEvent& a, const TickEvent& b) { return a.m_tick < b.m_tick; });
+
+    /* Resolve ticks to seconds, tracking tempo changes as they pass */
+    double secPerTick;
+    bool smpte = (division & 0x8000) != 0;
+    if (smpte)
+    {
+        int fps = -int8_t(division >> 8);
+        double realFps = fps == 29 ? 29.97 : fps;
+        secPerTick = 1.0 / (realFps * (division & 0xff));
+    }
+    else
+    {
+        if (!division)
+        {
+            Log.report(logvisor::Error, "invalid SMF division");
+            return;
+        }
+        secPerTick = 0.5 / division;
+    }
+
+    uint64_t lastTick = 0;
+    double lastTime = 0.0;
+    m_events.reserve(tickEvents.size());
+    for (TickEvent& te : tickEvents)
+    {
+        lastTime += (te.m_tick - lastTick) * secPerTick;
+        lastTick = te.m_tick;
+        te.m_ev.m_time = lastTime;
+
+        if (!smpte && te.m_ev.m_status == 0xFF && te.m_ev.m_data[0] == 0x51 && te.m_ev.m_payloadLen == 3)
+        {
+            const uint8_t* tempo = &m_payload[te.m_ev.m_payloadOffset];
+            uint32_t usPerQuarter = uint32_t(tempo[0]) << 16 | uint32_t(tempo[1]) << 8 | tempo[2];
+            secPerTick = usPerQuarter / 1.0e6 / division;
+        }
+
+        m_events.push_back(te.m_ev);
+    }
+
+    m_duration = lastTime;
+    m_valid = true;
+}
+
+std::shared_ptr<MIDISequence> MIDISequence::LoadFile(const char* path)
+{
+#if _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return {};
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return {};
+    }
+    const uint8_t* data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    std::shared_ptr<MIDISequence> ret;
+    if (data)
+    {
+        ret = std::make_shared<MIDISequence>(data, size_t(size.QuadPart));
+        UnmapViewOfFile(data);
+    }
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return {};
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size)
+    {
+        close(fd);
+        return {};
+    }
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return {};
+    std::shared_ptr<MIDISequence> ret =
+        std::make_shared<MIDISequence>(static_cast<const uint8_t*>(data), size_t(st.st_size));
+    munmap(data, size_t(st.st_size));
+#endif
+
+    if (ret && !ret->isValid())
+        return {};
+    return ret;
+}
+
+void MIDISequence::dispatch(const Event& ev, IMIDIReader& reader) const
+{
+    switch (ev.m_status)
+    {
+    case 0xF0:
+    {
+        const uint8_t* payload = ev.m_payloadLen ? &m_payload[ev.m_payloadOffset] : nullptr;
+        /* Sequence SysEx is already whole; streaming readers get it as a single chunk */
+        if (reader.streamsSysEx())
+            reader.sysexChunk(payload, ev.m_payloadLen, true, true);
+        else
+            reader.sysex(payload, ev.m_payloadLen);
+        break;
+    }
+    case 0xFF:
+        reader.metaEvent(ev.m_data[0], ev.m_payloadLen ? &m_payload[ev.m_payloadOffset] : nullptr,
+                         ev.m_payloadLen);
+        break;
+    default:
+        DispatchStatus(reader, ev.m_status, ev.m_data);
+        break;
+    }
+}
+
+}
@@ -29,7 +29,7 @@ struct WASAPIAudioVoiceEngine : BaseAudioVoiceEngine
     ComPtr<IAudioRenderClient> m_renderClient;
 
     size_t m_curBufFrame = 0;
-    std::vector<float> m_5msBuffer;
+    std::vector<float> m_mixBuffer;
 
     struct NotificationClient : public IMMNotificationClient
     {
@@ -232,8 +232,9 @@ struct WASAPIAudioVoiceEngine : BaseAudioVoiceEngine
         }
         m_mixInfo.m_sampleRate = pwfx->Format.nSamplesPerSec;
         m_5msFrames = (m_mixInfo.m_sampleRate * 5 / 500 + 1) / 2;
-        m_curBufFrame = m_5msFrames;
-        m_5msBuffer.resize(m_5msFrames * chMapOut.m_channelCount);
+        _resetMixQuantum();
+        m_curBufFrame = m_mixQuantumFrames;
+        m_mixBuffer.resize(m_mixQuantumFrames * chMapOut.m_channelCount);
 
         if (pwfx->Format.wFormatTag == WAVE_FORMAT_PCM ||
             (pwfx->Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE && pwfx->SubFormat == KSDATAFORMAT_SUBTYPE_PCM))
@@ -332,6 +333,13 @@ struct WASAPIAudioVoiceEngine : BaseAudioVoiceEngine
              smx->_resetOutputSampleRate();
     }
 
+    void setMixQuantumFrames(size_t frames)
+    {
+        BaseAudioVoiceEngine::setMixQuantumFrames(frames);
+        m_curBufFrame = m_mixQuantumFrames;
+        m_mixBuffer.resize(m_mixQuantumFrames * m_mixInfo.m_channelMap.m_channelCount);
+    }
+
     void pumpAndMixVoices()
     {
         int attempt = 0;
@@ -380,17 +388,17 @@ struct WASAPIAudioVoiceEngine : BaseAudioVoiceEngine
 
             for (size_t f=0 ; f<frames ;)
             {
-                if (m_curBufFrame == m_5msFrames)
+                if (m_curBufFrame == m_mixQuantumFrames)
                 {
-                    _pumpAndMixVoices(m_5msFrames, m_5msBuffer.data());
+                    _pumpAndMixVoices(m_mixQuantumFrames, m_mixBuffer.data());
                     m_curBufFrame = 0;
                 }
 
-                size_t remRenderFrames = std::min(frames - f, m_5msFrames - m_curBufFrame);
+                size_t remRenderFrames = std::min(frames - f, m_mixQuantumFrames - m_curBufFrame);
                 if (remRenderFrames)
                 {
                     memmove(reinterpret_cast<float*>(bufOut) + m_mixInfo.m_channelMap.m_channelCount * f,
-                            &m_5msBuffer[m_curBufFrame * m_mixInfo.m_channelMap.m_channelCount],
+                            &m_mixBuffer[m_curBufFrame * m_mixInfo.m_channelMap.m_channelCount],
                             remRenderFrames * m_mixInfo.m_channelMap.m_channelCount * sizeof(float));
                     m_curBufFrame += remRenderFrames;
                     f += remRenderFrames;
@@ -467,8 +475,7 @@ struct WASAPIAudioVoiceEngine : BaseAudioVoiceEngine
         if (wMsg == MIM_DATA)
         {
             uint8_t (&ptr)[3] = reinterpret_cast<uint8_t(&)[3]>(dwParam1);
-            std::vector<uint8_t> bytes(std::cbegin(ptr), std::cend(ptr));
-            dwInstance->m_receiver(std::move(bytes), dwParam2 / 1000.0);
+            dwInstance->m_receiver(ptr, 3, dwParam2 / 1000.0);
         }
     }
 
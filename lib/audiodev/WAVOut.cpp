@@ -145,7 +145,8 @@ struct WAVOutVoiceEngine : boo::BaseAudioVoiceEngine
         unsigned chCount = ChannelCount(m_mixInfo.m_channels);
 
         m_5msFrames = m_mixInfo.m_sampleRate * 5 / 1000;
-        m_interleavedBuf.resize(2 * m_5msFrames);
+        _resetMixQuantum();
+        m_interleavedBuf.resize(2 * m_mixQuantumFrames);
 
         boo::ChannelMap& chMapOut = m_mixInfo.m_channelMap;
         chMapOut.m_channelCount = 2;
@@ -170,9 +171,15 @@ struct WAVOutVoiceEngine : boo::BaseAudioVoiceEngine
 
     void pumpAndMixVoices()
     {
-        _pumpAndMixVoices(m_5msFrames, m_interleavedBuf.data());
-        fwrite(m_interleavedBuf.data(), 1, m_5msFrames * 8, m_fp);
-        m_bytesWritten += m_5msFrames * 8;
+        _pumpAndMixVoices(m_mixQuantumFrames, m_interleavedBuf.data());
+        fwrite(m_interleavedBuf.data(), 1, m_mixQuantumFrames * 8, m_fp);
+        m_bytesWritten += m_mixQuantumFrames * 8;
+    }
+
+    void setMixQuantumFrames(size_t frames)
+    {
+        BaseAudioVoiceEngine::setMixQuantumFrames(frames);
+        m_interleavedBuf.resize(2 * m_mixQuantumFrames);
     }
 };
 
@@ -4,7 +4,11 @@
 /* Private header for managing shader data
  * binding lifetimes through rendering cycle */
 
+#include <algorithm>
 #include <atomic>
+#include <mutex>
+#include <vector>
+#include <string.h>
 #include "boo/graphicsdev/IGraphicsDataFactory.hpp"
 
 namespace boo
@@ -66,6 +70,10 @@ public:
             m_factory._unregisterShareableShader(m_srckey, m_binKey);
     }
 
+    /* Factories check this under their lock before erasing, since another
+     * thread may have re-acquired the object after the count hit zero */
+    bool expired() const { return m_refCount.load() == 0; }
+
     class Token
     {
         IShareableShader<FactoryImpl, ShaderImpl>* m_parent = nullptr;
@@ -88,6 +96,198 @@ public:
     Token lock() { return Token(this); }
 };
 
+class DirtyResourceList;
+
+/* Dynamic buffer/texture state shared by backends: m_validSlots has a bit per
+ * per-frame copy holding the latest CPU contents. Once committed, load()/unmap()
+ * enqueue the resource on its factory's DirtyResourceList, so the command queue
+ * refreshes only resources that changed rather than scanning everything */
+class IDynamicResourcePriv
+{
+    friend class DirtyResourceList;
+    std::atomic<DirtyResourceList*> m_dirtyList = {nullptr};
+    IDynamicResourcePriv* m_dirtyNext = nullptr;
+    std::atomic_bool m_dirtyQueued = {false};
+protected:
+    std::atomic_int m_validSlots = {0};
+    void markDirty();
+
+    /* Enqueue without resetting m_validSlots (for backends that write some slots directly) */
+    void queueDirty();
+
+    /* Backends call this first thing in their destructor so the queue
+     * never updates a partially destroyed resource */
+    void detachDirtyList();
+public:
+    virtual ~IDynamicResourcePriv();
+    virtual void update(int b)=0;
+    void attachDirtyList(DirtyResourceList& list);
+};
+
+/* Lock-free (Treiber stack) for producers; the queue drains it under m_lock.
+ * Resources stay pending until every slot in allSlots is current */
+class DirtyResourceList
+{
+    std::atomic<IDynamicResourcePriv*> m_head = {nullptr};
+    std::mutex m_lock;
+    std::vector<IDynamicResourcePriv*> m_pending;
+
+    void _drain()
+    {
+        IDynamicResourcePriv* res = m_head.exchange(nullptr, std::memory_order_acquire);
+        while (res)
+        {
+            m_pending.push_back(res);
+            res = res->m_dirtyNext;
+        }
+    }
+
+public:
+    void push(IDynamicResourcePriv* res)
+    {
+        IDynamicResourcePriv* head = m_head.load(std::memory_order_relaxed);
+        do res->m_dirtyNext = head;
+        while (!m_head.compare_exchange_weak(head, res, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    void update(int b, int allSlots)
+    {
+        std::unique_lock<std::mutex> lk(m_lock);
+        _drain();
+        size_t keep = 0;
+        for (IDynamicResourcePriv* res : m_pending)
+        {
+            res->update(b);
+            /* Re-claim the queued flag only if slots remain stale; a concurrent
+             * markDirty() that wins the flag re-pushes the resource instead */
+            res->m_dirtyQueued.store(false);
+            if (res->m_validSlots.load() != allSlots && !res->m_dirtyQueued.exchange(true))
+                m_pending[keep++] = res;
+        }
+        m_pending.resize(keep);
+    }
+
+    void remove(IDynamicResourcePriv* res)
+    {
+        std::unique_lock<std::mutex> lk(m_lock);
+        if (!res->m_dirtyQueued.load())
+            return;
+        _drain();
+        for (auto it = m_pending.begin() ; it != m_pending.end() ; ++it)
+        {
+            if (*it == res)
+            {
+                m_pending.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+inline void IDynamicResourcePriv::queueDirty()
+{
+    if (DirtyResourceList* list = m_dirtyList.load())
+        if (!m_dirtyQueued.exchange(true))
+            list->push(this);
+}
+
+inline void IDynamicResourcePriv::markDirty()
+{
+    m_validSlots.store(0);
+    queueDirty();
+}
+
+inline void IDynamicResourcePriv::detachDirtyList()
+{
+    if (DirtyResourceList* list = m_dirtyList.exchange(nullptr))
+        list->remove(this);
+}
+
+inline IDynamicResourcePriv::~IDynamicResourcePriv()
+{
+    detachDirtyList();
+}
+
+inline void IDynamicResourcePriv::attachDirtyList(DirtyResourceList& list)
+{
+    m_dirtyList.store(&list);
+    if (!m_dirtyQueued.exchange(true))
+        list.push(this);
+}
+
+/* Texel rectangle a dynamic texture copy lacks relative to the CPU contents */
+struct TextureDirtyRect
+{
+    size_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    bool empty() const {return x0 >= x1 || y0 >= y1;}
+    void clear() {x0 = y0 = x1 = y1 = 0;}
+    void merge(size_t x, size_t y, size_t w, size_t h)
+    {
+        if (empty())
+        {
+            x0 = x; y0 = y; x1 = x + w; y1 = y + h;
+            return;
+        }
+        x0 = std::min(x0, x);
+        y0 = std::min(y0, y);
+        x1 = std::max(x1, x + w);
+        y1 = std::max(y1, y + h);
+    }
+};
+
+/* Clip a loadRegion() request to the texture and copy it into a tightly
+ * packed CPU image; returns false when nothing remains */
+static inline bool CopyTextureRegion(uint8_t* dst, size_t width, size_t height, size_t pxPitch,
+                                     size_t x, size_t y, size_t& w, size_t& h,
+                                     const void* data, size_t pitch)
+{
+    if (x >= width || y >= height)
+        return false;
+    w = std::min(w, width - x);
+    h = std::min(h, height - y);
+    if (!w || !h)
+        return false;
+    size_t rowSz = w * pxPitch;
+    if (!pitch)
+        pitch = rowSz;
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    dst += (y * width + x) * pxPitch;
+    for (size_t i=0 ; i<h ; ++i, src += pitch, dst += width * pxPitch)
+        memcpy(dst, src, rowSz);
+    return true;
+}
+
+/* Per-frame bump allocator for IGraphicsCommandQueue::allocTransientUniform;
+ * backends own the storage (one region per frame in flight) and reset()
+ * the head whenever the recording frame changes */
+class TransientUniformRing
+{
+    size_t m_capacity = 0;
+    size_t m_align = 256;
+    size_t m_head = 0;
+public:
+    static constexpr size_t FrameSize = 4 * 1024 * 1024;
+
+    void init(size_t capacity, size_t align)
+    {
+        m_capacity = capacity;
+        m_align = std::max(align, size_t(16));
+        m_head = 0;
+    }
+    bool alloc(size_t size, size_t& offsetOut)
+    {
+        size_t offset = (m_head + m_align - 1) / m_align * m_align;
+        if (offset + size > m_capacity)
+            return false;
+        offsetOut = offset;
+        m_head = offset + size;
+        return true;
+    }
+    size_t used() const {return m_head;}
+    void reset() {m_head = 0;}
+};
+
 }
 
 #endif // BOO_GRAPHICSDEV_COMMON_HPP
@@ -71,7 +71,8 @@ static const D3D11_BIND_FLAG USE_TABLE[] =
     D3D11_BIND_VERTEX_BUFFER,
     D3D11_BIND_VERTEX_BUFFER,
     D3D11_BIND_INDEX_BUFFER,
-    D3D11_BIND_CONSTANT_BUFFER
+    D3D11_BIND_CONSTANT_BUFFER,
+    D3D11_BIND_SHADER_RESOURCE
 };
 
 class D3D11GraphicsBufferS : public IGraphicsBufferS
@@ -287,6 +288,7 @@ public:
     void load(const void* data, size_t sz);
     void* map(size_t sz);
     void unmap();
+    void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch);
 };
 
 class D3D11TextureR : public ITextureR
@@ -1047,6 +1049,28 @@ struct D3D11CommandQueue : IGraphicsCommandQueue
         m_deferredCtx->DrawIndexedInstanced(count, instCount, start, 0, 0);
     }
 
+    void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirect unsupported on D3D11");
+    }
+
+    void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirect unsupported on D3D11");
+    }
+
+    void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                           IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirectCount unsupported on D3D11");
+    }
+
+    void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                  IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirectCount unsupported on D3D11");
+    }
+
     void resolveBindTexture(ITextureR* texture, const SWindowRect& rect, bool tlOrigin, bool color, bool depth)
     {
         const D3D11TextureR* tex = static_cast<const D3D11TextureR*>(texture);
@@ -1150,6 +1174,12 @@ void D3D11TextureD::unmap()
     m_validSlots = 0;
     m_q->m_dynamicLock.unlock();
 }
+void D3D11TextureD::loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)
+{
+    std::unique_lock<std::recursive_mutex> lk(m_q->m_dynamicLock);
+    if (CopyTextureRegion(m_cpuBuf.get(), m_width, m_height, m_pxPitch, x, y, w, h, data, pitch))
+        m_validSlots = 0;
+}
 
 class D3D11DataFactory : public ID3DDataFactory
 {
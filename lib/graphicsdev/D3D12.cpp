@@ -82,7 +82,8 @@ static const D3D12_RESOURCE_STATES USE_TABLE[] =
     D3D12_RESOURCE_STATE_COMMON,
     D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
     D3D12_RESOURCE_STATE_INDEX_BUFFER,
-    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+    D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT
 };
 
 class D3D12GraphicsBufferS : public IGraphicsBufferS
@@ -397,6 +398,7 @@ public:
     void load(const void* data, size_t sz);
     void* map(size_t sz);
     void unmap();
+    void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch);
 
     UINT64 placeForGPU(D3D12Context* ctx, ID3D12Heap* gpuHeap, UINT64 offset)
     {
@@ -1305,6 +1307,28 @@ struct D3D12CommandQueue : IGraphicsCommandQueue
         m_cmdList->DrawIndexedInstanced(count, instCount, start, 0, 0);
     }
 
+    void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirect unsupported on D3D12");
+    }
+
+    void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirect unsupported on D3D12");
+    }
+
+    void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                           IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirectCount unsupported on D3D12");
+    }
+
+    void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                  IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirectCount unsupported on D3D12");
+    }
+
     void resolveBindTexture(ITextureR* texture, const SWindowRect& rect, bool tlOrigin, bool color, bool depth)
     {
         const D3D12TextureR* tex = static_cast<const D3D12TextureR*>(texture);
@@ -1551,6 +1575,11 @@ void D3D12TextureD::unmap()
 {
     m_validSlots = 0;
 }
+void D3D12TextureD::loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)
+{
+    if (CopyTextureRegion(m_cpuBuf.get(), m_width, m_height, m_rowPitch / m_width, x, y, w, h, data, pitch))
+        m_validSlots = 0;
+}
 
 class D3D12DataFactory : public ID3DDataFactory
 {
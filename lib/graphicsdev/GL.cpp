@@ -1,6 +1,7 @@
 #include "boo/graphicsdev/GL.hpp"
 #include "boo/graphicsdev/glew.h"
 #include "boo/IGraphicsContext.hpp"
+#include "boo/Trace.hpp"
 #include "Common.hpp"
 #include <vector>
 #include <thread>
@@ -12,6 +13,19 @@
 #include <atomic>
 #include <functional>
 #include "xxhash.h"
+#include <stdio.h>
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "logvisor/logvisor.hpp"
 
@@ -31,6 +45,291 @@ struct GLShareableShader : IShareableShader<GLDataFactoryImpl, GLShareableShader
     ~GLShareableShader() { glDeleteShader(m_shader); }
 };
 
+/* Linked programs shared by every pipeline with the same sources and bindings */
+struct GLShareableProgram;
+struct GLProgramRegistry
+{
+    std::recursive_mutex& m_lock;
+    std::unordered_map<uint64_t, std::unique_ptr<GLShareableProgram>> m_programs;
+    GLProgramRegistry(std::recursive_mutex& lock) : m_lock(lock) {}
+    void _unregisterShareableShader(uint64_t srcKey, uint64_t binKey);
+    void _storePendingBinaries();
+};
+
+/* Program binaries (ARB_get_program_binary) persisted in one file: a header,
+ * a record table, then the blobs. The file is mapped read-only while in use;
+ * programs linked this run are held in memory until save() rewrites it */
+class GLProgramBinaryCache
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        uint64_t driverHash;
+    };
+    struct Record
+    {
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+        uint64_t offset;
+    };
+    struct Entry
+    {
+        GLenum format;
+        const uint8_t* data;
+        size_t size;
+    };
+    static constexpr uint32_t Version = 1;
+
+    std::mutex m_lock;
+    std::string m_path;
+    uint64_t m_driverHash = 0;
+    bool m_enabled = false;
+    void* m_map = nullptr;
+    size_t m_mapSz = 0;
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::unordered_map<uint64_t, std::pair<GLenum, std::vector<uint8_t>>> m_added;
+
+    void _map();
+    void _unmap();
+public:
+    ~GLProgramBinaryCache() {_unmap();}
+    bool open(const char* path);
+    bool enabled() const {return m_enabled;}
+    uint64_t driverHash() const {return m_driverHash;}
+
+    /* Returns a linked program, or 0 on a miss or a binary the driver rejects */
+    GLuint load(uint64_t key);
+    void store(uint64_t key, GLuint prog);
+    bool save();
+};
+
+bool GLProgramBinaryCache::open(const char* path)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    _unmap();
+    m_added.clear();
+    m_enabled = false;
+
+    GLint formatCount = 0;
+    if (GLEW_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (!formatCount)
+    {
+        Log.report(logvisor::Warning, "program binaries unsupported by driver; cache disabled");
+        return false;
+    }
+
+    XXH64_state_t hashState;
+    XXH64_reset(&hashState, 0);
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+    {
+        const char* str = reinterpret_cast<const char*>(glGetString(name));
+        if (str)
+            XXH64_update(&hashState, str, strlen(str) + 1);
+    }
+    m_driverHash = XXH64_digest(&hashState);
+    m_path = path;
+    m_enabled = true;
+    _map();
+    return true;
+}
+
+void GLProgramBinaryCache::_map()
+{
+#if _WIN32
+    HANDLE file = CreateFileA(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = size.QuadPart ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (mapping)
+    {
+        m_map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        m_mapSz = m_map ? size_t(size.QuadPart) : 0;
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(m_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size)
+    {
+        void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            m_map = data;
+            m_mapSz = size_t(st.st_size);
+        }
+    }
+    close(fd);
+#endif
+    if (!m_map)
+        return;
+
+    const uint8_t* base = static_cast<const uint8_t*>(m_map);
+    Header header;
+    if (m_mapSz < sizeof(Header))
+    {
+        _unmap();
+        return;
+    }
+    memcpy(&header, base, sizeof(Header));
+    if (memcmp(header.magic, "BOOGLPBC", 8) || header.version != Version ||
+        m_mapSz < sizeof(Header) + size_t(header.count) * sizeof(Record))
+    {
+        Log.report(logvisor::Warning, "ignoring malformed program binary cache '%s'", m_path.c_str());
+        _unmap();
+        return;
+    }
+    if (header.driverHash != m_driverHash)
+    {
+        Log.report(logvisor::Info, "GL driver changed; rebuilding program binary cache '%s'", m_path.c_str());
+        _unmap();
+        return;
+    }
+
+    for (uint32_t i=0 ; i<header.count ; ++i)
+    {
+        Record rec;
+        memcpy(&rec, base + sizeof(Header) + i * sizeof(Record), sizeof(Record));
+        if (rec.offset > m_mapSz || rec.size > m_mapSz - rec.offset)
+            continue;
+        m_entries[rec.key] = {GLenum(rec.format), base + rec.offset, rec.size};
+    }
+}
+
+void GLProgramBinaryCache::_unmap()
+{
+    m_entries.clear();
+    if (!m_map)
+        return;
+#if _WIN32
+    UnmapViewOfFile(m_map);
+#else
+    munmap(m_map, m_mapSz);
+#endif
+    m_map = nullptr;
+    m_mapSz = 0;
+}
+
+GLuint GLProgramBinaryCache::load(uint64_t key)
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    GLenum format;
+    const uint8_t* data;
+    size_t size;
+    auto added = m_added.find(key);
+    if (added != m_added.end())
+    {
+        format = added->second.first;
+        data = added->second.second.data();
+        size = added->second.second.size();
+    }
+    else
+    {
+        auto search = m_entries.find(key);
+        if (search == m_entries.end())
+            return 0;
+        format = search->second.format;
+        data = search->second.data;
+        size = search->second.size;
+    }
+
+    GLuint prog = glCreateProgram();
+    glProgramBinary(prog, format, data, GLsizei(size));
+    GLint status;
+    glGetProgramiv(prog, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        /* Stale or rejected; caller relinks from source and store() replaces it */
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+void GLProgramBinaryCache::store(uint64_t key, GLuint prog)
+{
+    GLint size = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return;
+    std::pair<GLenum, std::vector<uint8_t>> entry;
+    entry.second.resize(size);
+    glGetProgramBinary(prog, size, nullptr, &entry.first, entry.second.data());
+
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_entries.erase(key);
+    m_added[key] = std::move(entry);
+}
+
+bool GLProgramBinaryCache::save()
+{
+    std::unique_lock<std::mutex> lk(m_lock);
+    if (!m_enabled || m_added.empty())
+        return true;
+
+    std::vector<Record> records;
+    std::vector<const uint8_t*> blobs;
+    records.reserve(m_entries.size() + m_added.size());
+    blobs.reserve(m_entries.size() + m_added.size());
+    uint64_t offset = sizeof(Header) + (m_entries.size() + m_added.size()) * sizeof(Record);
+    for (const auto& ent : m_entries)
+    {
+        records.push_back({ent.first, uint32_t(ent.second.format), uint32_t(ent.second.size), offset});
+        blobs.push_back(ent.second.data);
+        offset += ent.second.size;
+    }
+    for (const auto& ent : m_added)
+    {
+        records.push_back({ent.first, uint32_t(ent.second.first), uint32_t(ent.second.second.size()), offset});
+        blobs.push_back(ent.second.second.data());
+        offset += ent.second.second.size();
+    }
+
+    /* Write beside the live file and swap it in, so a crash never leaves a torn cache */
+    std::string tmpPath = m_path + ".tmp";
+    FILE* fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp)
+    {
+        Log.report(logvisor::Error, "unable to open '%s' for writing", tmpPath.c_str());
+        return false;
+    }
+    Header header = {{'B','O','O','G','L','P','B','C'}, Version, uint32_t(records.size()), m_driverHash};
+    bool ok = fwrite(&header, sizeof(Header), 1, fp) == 1;
+    if (records.size())
+        ok &= fwrite(records.data(), sizeof(Record), records.size(), fp) == records.size();
+    for (size_t i=0 ; i<records.size() ; ++i)
+        ok &= fwrite(blobs[i], 1, records[i].size, fp) == records[i].size;
+    ok &= fclose(fp) == 0;
+    if (!ok)
+    {
+        Log.report(logvisor::Error, "unable to write program binary cache '%s'", tmpPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    _unmap();
+#if _WIN32
+    ok = MoveFileExA(tmpPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = rename(tmpPath.c_str(), m_path.c_str()) == 0;
+#endif
+    if (!ok)
+        Log.report(logvisor::Error, "unable to replace program binary cache '%s'", m_path.c_str());
+    else
+        m_added.clear();
+    _map();
+    return ok;
+}
+
 class GLDataFactoryImpl : public GLDataFactory
 {
     friend struct GLCommandQueue;
@@ -41,7 +340,21 @@ class GLDataFactoryImpl : public GLDataFactory
     std::unordered_set<struct GLData*> m_committedData;
     std::unordered_set<struct GLPool*> m_committedPools;
     std::mutex m_committedMutex;
+    DirtyResourceList m_dirtyResources;
+
+    /* Load contexts may build pipelines concurrently; guards both registries
+     * (recursive, since releasing a program releases its shaders) */
+    std::recursive_mutex m_sharedLock;
     std::unordered_map<uint64_t, std::unique_ptr<GLShareableShader>> m_sharedShaders;
+    GLProgramRegistry m_sharedPrograms = {m_sharedLock};
+    GLProgramBinaryCache m_programCache;
+
+    /* Compiler thread count is per-context state; holds this once set on a thread */
+    ThreadLocalPtr<GLDataFactoryImpl> m_compilerThreadsSet;
+
+    /* Fences behind each commitTransaction(); the render thread waits on them
+     * server-side so uploads from other contexts are complete before use */
+    std::vector<GLsync> m_uploadFences;
     void destroyData(IGraphicsData*);
     void destroyAllData();
     void destroyPool(IGraphicsBufferPool*);
@@ -50,7 +363,14 @@ class GLDataFactoryImpl : public GLDataFactory
     void deletePoolBuffer(IGraphicsBufferPool* p, IGraphicsBufferD* buf);
 public:
     GLDataFactoryImpl(IGraphicsContext* parent, uint32_t drawSamples);
-    ~GLDataFactoryImpl() {destroyAllData();}
+    ~GLDataFactoryImpl() {m_programCache.save(); destroyAllData();}
+
+    bool setProgramBinaryCachePath(const char* path) {return m_programCache.open(path);}
+    bool saveProgramBinaryCache()
+    {
+        m_sharedPrograms._storePendingBinaries();
+        return m_programCache.save();
+    }
 
     Platform platform() const {return Platform::OpenGL;}
     const SystemChar* platformName() const {return _S("OpenGL");}
@@ -60,7 +380,10 @@ public:
 
     void _unregisterShareableShader(uint64_t srcKey, uint64_t binKey)
     {
-        m_sharedShaders.erase(srcKey);
+        std::unique_lock<std::recursive_mutex> lk(m_sharedLock);
+        auto search = m_sharedShaders.find(srcKey);
+        if (search != m_sharedShaders.end() && search->second->expired())
+            m_sharedShaders.erase(search);
     }
 };
 
@@ -88,7 +411,220 @@ static const GLenum USE_TABLE[] =
     GL_INVALID_ENUM,
     GL_ARRAY_BUFFER,
     GL_ELEMENT_ARRAY_BUFFER,
-    GL_UNIFORM_BUFFER
+    GL_UNIFORM_BUFFER,
+    GL_DRAW_INDIRECT_BUFFER
+};
+
+/* GL_DRAW_INDIRECT_BUFFER and glDraw*Indirect need GL 4.0; 3.3 contexts emulate */
+static bool HasDrawIndirect()
+{
+    return GLEW_VERSION_4_0 || GLEW_ARB_draw_indirect;
+}
+
+/* Requires a current context; indirect buffers are plain storage without draw-indirect */
+static GLenum BufferTarget(BufferUse use)
+{
+    if (use == BufferUse::Indirect && !HasDrawIndirect())
+        return GL_COPY_WRITE_BUFFER;
+    return USE_TABLE[int(use)];
+}
+
+/* Requires a current context; the limit is identical across shared contexts */
+static size_t UniformOffsetAlignment()
+{
+    static size_t Align = 0;
+    if (!Align)
+    {
+        GLint align = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        Align = std::max(align, 1);
+    }
+    return Align;
+}
+
+/* Render-thread mirror of the GL state touched during command replay, used to
+ * filter redundant driver calls. Reset at the start of every replayed frame:
+ * objects may be deleted (and their names reused) between frames */
+struct GLStateCache
+{
+    static constexpr size_t TexUnitCount = 16;
+    static constexpr size_t UniformCount = BOO_GLSL_MAX_UNIFORM_COUNT;
+
+    GLuint m_program;
+    GLuint m_vao;
+    int m_blend;
+    GLenum m_sfactor, m_dfactor;
+    int m_depthTest;
+    int m_depthWrite;
+    GLenum m_depthFunc;
+    int m_cull;
+    GLenum m_cullFace;
+    size_t m_activeUnit;
+    struct TexUnit
+    {
+        GLenum m_target;
+        GLuint m_tex;
+    } m_texUnits[TexUnitCount];
+    struct UniformBinding
+    {
+        GLuint m_buf;
+        GLintptr m_off;
+        GLsizeiptr m_size;
+    } m_uniforms[UniformCount];
+
+    GLStateCache() {reset();}
+
+    void reset()
+    {
+        /* Sentinels that never match a real value force the next call through */
+        m_program = ~GLuint(0);
+        m_vao = ~GLuint(0);
+        m_blend = -1;
+        m_sfactor = m_dfactor = GL_INVALID_ENUM;
+        m_depthTest = -1;
+        m_depthWrite = -1;
+        m_depthFunc = GL_INVALID_ENUM;
+        m_cull = -1;
+        m_cullFace = GL_INVALID_ENUM;
+        m_activeUnit = ~size_t(0);
+        for (TexUnit& unit : m_texUnits)
+            unit = {GL_INVALID_ENUM, ~GLuint(0)};
+        for (UniformBinding& uni : m_uniforms)
+            uni = {~GLuint(0), -1, -1};
+    }
+
+    void useProgram(GLuint prog)
+    {
+        if (prog == m_program)
+            return;
+        glUseProgram(prog);
+        m_program = prog;
+    }
+
+    void bindVertexArray(GLuint vao)
+    {
+        if (vao == m_vao)
+            return;
+        glBindVertexArray(vao);
+        m_vao = vao;
+    }
+
+    void setBlend(GLenum sfactor, GLenum dfactor)
+    {
+        int enable = dfactor != GL_ZERO;
+        if (enable != m_blend)
+        {
+            if (enable)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+            m_blend = enable;
+        }
+        if (enable && (sfactor != m_sfactor || dfactor != m_dfactor))
+        {
+            glBlendFunc(sfactor, dfactor);
+            m_sfactor = sfactor;
+            m_dfactor = dfactor;
+        }
+    }
+
+    void setDepthTest(bool enable)
+    {
+        if (int(enable) == m_depthTest)
+            return;
+        if (enable)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+        m_depthTest = enable;
+    }
+
+    void setDepthWrite(bool enable)
+    {
+        if (int(enable) == m_depthWrite)
+            return;
+        glDepthMask(enable);
+        m_depthWrite = enable;
+    }
+
+    void setDepthFunc(GLenum func)
+    {
+        if (func == m_depthFunc)
+            return;
+        glDepthFunc(func);
+        m_depthFunc = func;
+    }
+
+    void setCulling(CullMode culling)
+    {
+        int enable = culling != CullMode::None;
+        if (enable != m_cull)
+        {
+            if (enable)
+                glEnable(GL_CULL_FACE);
+            else
+                glDisable(GL_CULL_FACE);
+            m_cull = enable;
+        }
+        GLenum face = culling == CullMode::Backface ? GL_BACK : GL_FRONT;
+        if (enable && face != m_cullFace)
+        {
+            glCullFace(face);
+            m_cullFace = face;
+        }
+    }
+
+    void activeTexture(size_t unit)
+    {
+        if (unit == m_activeUnit)
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+    }
+
+    void bindTexture(size_t unit, GLenum target, GLuint tex)
+    {
+        if (unit >= TexUnitCount)
+        {
+            activeTexture(unit);
+            glBindTexture(target, tex);
+            return;
+        }
+        TexUnit& cached = m_texUnits[unit];
+        if (cached.m_target == target && cached.m_tex == tex)
+            return;
+        activeTexture(unit);
+        glBindTexture(target, tex);
+        cached = {target, tex};
+    }
+
+    void bindUniformRange(size_t idx, GLuint buf, GLintptr off, GLsizeiptr size)
+    {
+        if (idx >= UniformCount)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, idx, buf, off, size);
+            return;
+        }
+        UniformBinding& cached = m_uniforms[idx];
+        if (cached.m_buf == buf && cached.m_off == off && cached.m_size == size)
+            return;
+        glBindBufferRange(GL_UNIFORM_BUFFER, idx, buf, off, size);
+        cached = {buf, off, size};
+    }
+
+    void bindUniformBase(size_t idx, GLuint buf)
+    {
+        if (idx >= UniformCount)
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, idx, buf);
+            return;
+        }
+        UniformBinding& cached = m_uniforms[idx];
+        if (cached.m_buf == buf && cached.m_off == 0 && cached.m_size == 0)
+            return;
+        glBindBufferBase(GL_UNIFORM_BUFFER, idx, buf);
+        cached = {buf, 0, 0};
+    }
 };
 
 class GLGraphicsBufferS : public IGraphicsBufferS
@@ -99,7 +635,7 @@ class GLGraphicsBufferS : public IGraphicsBufferS
     GLenum m_target;
     GLGraphicsBufferS(BufferUse use, const void* data, size_t sz)
     {
-        m_target = USE_TABLE[int(use)];
+        m_target = BufferTarget(use);
         glGenBuffers(1, &m_buf);
         glBindBuffer(m_target, m_buf);
         glBufferData(m_target, sz, data, GL_STATIC_DRAW);
@@ -111,35 +647,70 @@ public:
     {glBindBuffer(GL_ARRAY_BUFFER, m_buf);}
     void bindIndex() const
     {glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buf);}
-    void bindUniform(size_t idx) const
-    {glBindBufferBase(GL_UNIFORM_BUFFER, idx, m_buf);}
-    void bindUniformRange(size_t idx, GLintptr off, GLsizeiptr size) const
-    {glBindBufferRange(GL_UNIFORM_BUFFER, idx, m_buf, off, size);}
+    void bindUniform(GLStateCache& st, size_t idx) const
+    {st.bindUniformBase(idx, m_buf);}
+    void bindUniformRange(GLStateCache& st, size_t idx, GLintptr off, GLsizeiptr size) const
+    {st.bindUniformRange(idx, m_buf, off, size);}
 };
 
-class GLGraphicsBufferD : public IGraphicsBufferD
+class GLGraphicsBufferD : public IGraphicsBufferD, public IDynamicResourcePriv
 {
     friend class GLDataFactory;
     friend class GLDataFactoryImpl;
     friend struct GLCommandQueue;
+    friend struct GLShaderDataBinding;
+    struct GLCommandQueue* m_q;
     GLuint m_bufs[3];
     GLenum m_target;
-    std::unique_ptr<uint8_t[]> m_cpuBuf;
     size_t m_cpuSz = 0;
-    int m_validMask = 0;
-    GLGraphicsBufferD(BufferUse use, size_t sz)
-    : m_target(USE_TABLE[int(use)]), m_cpuBuf(new uint8_t[sz]), m_cpuSz(sz)
+
+    /* ARB_buffer_storage path: each per-frame copy is persistently and coherently
+     * mapped; load()/map() write straight into the copy for the frame being
+     * recorded (m_latest afterwards), once its fence shows the GPU is done with it */
+    uint8_t* m_mapped[3] = {};
+    bool m_transient = false;
+    int m_latest = 0;
+    int m_mapSlot = 0;
+    size_t m_mapSz = 0;
+
+    /* Fallback path: CPU shadow, uploaded per copy by dirty byte range */
+    std::unique_ptr<uint8_t[]> m_cpuBuf;
+
+    /* Byte range each copy lacks relative to the newest contents */
+    size_t m_dirtyLo[3] = {};
+    size_t m_dirtyHi[3] = {};
+
+    GLGraphicsBufferD(struct GLCommandQueue* q, BufferUse use, size_t sz)
+    : m_q(q), m_target(BufferTarget(use)), m_cpuSz(sz)
     {
         glGenBuffers(3, m_bufs);
-        for (int i=0 ; i<3 ; ++i)
+        if (GLEW_ARB_buffer_storage)
         {
-            glBindBuffer(m_target, m_bufs[i]);
-            glBufferData(m_target, m_cpuSz, nullptr, GL_STREAM_DRAW);
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT |
+                                     GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            for (int i=0 ; i<3 ; ++i)
+            {
+                glBindBuffer(m_target, m_bufs[i]);
+                glBufferStorage(m_target, m_cpuSz, nullptr, flags);
+                m_mapped[i] = static_cast<uint8_t*>(glMapBufferRange(m_target, 0, m_cpuSz, flags));
+            }
+        }
+        else
+        {
+            m_cpuBuf.reset(new uint8_t[sz]);
+            for (int i=0 ; i<3 ; ++i)
+            {
+                glBindBuffer(m_target, m_bufs[i]);
+                glBufferData(m_target, m_cpuSz, nullptr, GL_STREAM_DRAW);
+            }
         }
     }
+    bool persistent() const {return m_mapped[0] != nullptr;}
+    void _markWritten(int slot, size_t sz);
+    void _refreshSlot(int slot, size_t skipHi);
     void update(int b);
 public:
-    ~GLGraphicsBufferD() {glDeleteBuffers(3, m_bufs);}
+    ~GLGraphicsBufferD() {detachDirtyList(); glDeleteBuffers(3, m_bufs);}
 
     void load(const void* data, size_t sz);
     void* map(size_t sz);
@@ -147,8 +718,8 @@ public:
 
     void bindVertex(int b);
     void bindIndex(int b);
-    void bindUniform(size_t idx, int b);
-    void bindUniformRange(size_t idx, GLintptr off, GLsizeiptr size, int b);
+    void bindUniform(GLStateCache& st, size_t idx, int b);
+    void bindUniformRange(GLStateCache& st, size_t idx, GLintptr off, GLsizeiptr size, int b);
 };
 
 IGraphicsBufferS*
@@ -230,10 +801,9 @@ class GLTextureS : public ITextureS
 public:
     ~GLTextureS() {glDeleteTextures(1, &m_tex);}
 
-    void bind(size_t idx) const
+    void bind(GLStateCache& st, size_t idx) const
     {
-        glActiveTexture(GL_TEXTURE0 + idx);
-        glBindTexture(GL_TEXTURE_2D, m_tex);
+        st.bindTexture(idx, GL_TEXTURE_2D, m_tex);
     }
 };
 
@@ -284,25 +854,30 @@ class GLTextureSA : public ITextureSA
 public:
     ~GLTextureSA() {glDeleteTextures(1, &m_tex);}
 
-    void bind(size_t idx) const
+    void bind(GLStateCache& st, size_t idx) const
     {
-        glActiveTexture(GL_TEXTURE0 + idx);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, m_tex);
+        st.bindTexture(idx, GL_TEXTURE_2D_ARRAY, m_tex);
     }
 };
 
-class GLTextureD : public ITextureD
+class GLTextureD : public ITextureD, public IDynamicResourcePriv
 {
     friend class GLDataFactory;
     friend struct GLCommandQueue;
+    struct GLCommandQueue* m_q;
     GLuint m_texs[3];
     std::unique_ptr<uint8_t[]> m_cpuBuf;
     size_t m_cpuSz = 0;
+    size_t m_pxPitch = 4;
     GLenum m_intFormat, m_format;
     size_t m_width = 0;
     size_t m_height = 0;
-    int m_validMask = 0;
-    GLTextureD(size_t width, size_t height, TextureFormat fmt);
+
+    /* Region each copy lacks relative to m_cpuBuf; update() re-uploads only that */
+    TextureDirtyRect m_dirty[3];
+
+    GLTextureD(struct GLCommandQueue* q, size_t width, size_t height, TextureFormat fmt);
+    void _markRegion(size_t x, size_t y, size_t w, size_t h);
     void update(int b);
 public:
     ~GLTextureD();
@@ -310,8 +885,9 @@ public:
     void load(const void* data, size_t sz);
     void* map(size_t sz);
     void unmap();
+    void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch);
 
-    void bind(size_t idx, int b);
+    void bind(GLStateCache& st, size_t idx, int b);
 };
 
 class GLTextureR : public ITextureR
@@ -331,10 +907,9 @@ class GLTextureR : public ITextureR
 public:
     ~GLTextureR();
 
-    void bind(size_t idx) const
+    void bind(GLStateCache& st, size_t idx) const
     {
-        glActiveTexture(GL_TEXTURE0 + idx);
-        glBindTexture(m_target, m_bindTexs[0]);
+        st.bindTexture(idx, m_target, m_bindTexs[0]);
     }
 
     void resize(size_t width, size_t height)
@@ -403,72 +978,188 @@ GLDataFactory::Context::newStaticArrayTexture(size_t width, size_t height, size_
     return retval;
 }
 
-class GLShaderPipeline : public IShaderPipeline
+/* Program object and its lazily-resolved link state; pipelines differing only in
+ * fixed-function state reference the same one */
+struct GLShareableProgram : IShareableShader<GLProgramRegistry, GLShareableProgram>
 {
-    friend class GLDataFactory;
-    friend struct GLCommandQueue;
-    friend struct GLShaderDataBinding;
+    enum class LinkState
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
     GLShareableShader::Token m_vert;
     GLShareableShader::Token m_frag;
     GLuint m_prog = 0;
-    GLenum m_sfactor = GL_ONE;
-    GLenum m_dfactor = GL_ZERO;
-    GLenum m_drawPrim = GL_TRIANGLES;
-    bool m_depthTest = true;
-    bool m_depthWrite = true;
-    CullMode m_culling;
-    std::vector<GLint> m_uniLocs;
-    GLShaderPipeline() = default;
-public:
-    operator bool() const {return m_prog != 0;}
-    ~GLShaderPipeline() { if (m_prog) glDeleteProgram(m_prog); }
-    GLShaderPipeline& operator=(const GLShaderPipeline&) = delete;
-    GLShaderPipeline(const GLShaderPipeline&) = delete;
-    GLShaderPipeline& operator=(GLShaderPipeline&& other)
+
+    /* Link status is only queried once the pipeline is polled or first bound;
+     * everything below is resolved at that point under m_linkLock */
+    mutable std::mutex m_linkLock;
+    mutable std::atomic<LinkState> m_linkState = {LinkState::Pending};
+    mutable std::vector<GLint> m_uniLocs;
+    std::vector<std::string> m_uniBlockNames;
+    std::vector<std::string> m_texNames;
+    GLProgramBinaryCache* m_cache = nullptr;
+    uint64_t m_cacheKey = 0;
+
+    /* Set once linked from source; the binary is read back later on a load
+     * context (see GLProgramRegistry::_storePendingBinaries), never mid-frame */
+    mutable std::atomic_bool m_storePending = {false};
+
+    GLShareableProgram(GLProgramRegistry& reg, uint64_t key)
+    : IShareableShader(reg, key, 0) {}
+    ~GLShareableProgram() { if (m_prog) glDeleteProgram(m_prog); }
+
+    static void _reportShaderErrors(GLuint sobj, const char* stage)
     {
-        m_vert = std::move(other.m_vert);
-        m_frag = std::move(other.m_frag);
-        m_prog = other.m_prog;
-        other.m_prog = 0;
-        m_sfactor = other.m_sfactor;
-        m_dfactor = other.m_dfactor;
-        m_drawPrim = other.m_drawPrim;
-        m_depthTest = other.m_depthTest;
-        m_depthWrite = other.m_depthWrite;
-        m_culling = other.m_culling;
-        m_uniLocs = std::move(other.m_uniLocs);
-        return *this;
+        GLint status;
+        glGetShaderiv(sobj, GL_COMPILE_STATUS, &status);
+        if (status == GL_TRUE)
+            return;
+        GLint logLen, srcLen;
+        glGetShaderiv(sobj, GL_INFO_LOG_LENGTH, &logLen);
+        glGetShaderiv(sobj, GL_SHADER_SOURCE_LENGTH, &srcLen);
+        char* log = (char*)malloc(logLen + 1);
+        char* src = (char*)malloc(srcLen + 1);
+        log[0] = src[0] = '\0';
+        glGetShaderInfoLog(sobj, logLen + 1, nullptr, log);
+        glGetShaderSource(sobj, srcLen + 1, nullptr, src);
+        Log.report(logvisor::Error, "unable to compile %s source\n%s\n%s\n", stage, log, src);
+        free(log);
+        free(src);
     }
-    GLShaderPipeline(GLShaderPipeline&& other) { *this = std::move(other); }
 
-    GLuint bind() const
+    /* Blocks on the driver if the link is still in flight; requires a current context */
+    bool _resolve() const
     {
+        std::unique_lock<std::mutex> lk(m_linkLock);
+        LinkState state = m_linkState.load(std::memory_order_relaxed);
+        if (state != LinkState::Pending)
+            return state == LinkState::Ready;
+
+        GLint status;
+        glGetProgramiv(m_prog, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            if (m_vert)
+                _reportShaderErrors(m_vert.get().m_shader, "vert");
+            if (m_frag)
+                _reportShaderErrors(m_frag.get().m_shader, "frag");
+            GLint logLen;
+            glGetProgramiv(m_prog, GL_INFO_LOG_LENGTH, &logLen);
+            char* log = (char*)malloc(logLen + 1);
+            log[0] = '\0';
+            glGetProgramInfoLog(m_prog, logLen + 1, nullptr, log);
+            Log.report(logvisor::Error, "unable to link shader program\n%s\n", log);
+            free(log);
+            m_linkState.store(LinkState::Failed, std::memory_order_release);
+            return false;
+        }
+
+        if (m_cache)
+            m_storePending.store(true, std::memory_order_relaxed);
+
+        /* Restore the caller's program so render-thread state caching stays valid */
+        GLint prevProg;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &prevProg);
         glUseProgram(m_prog);
 
-        if (m_dfactor != GL_ZERO)
+        m_uniLocs.reserve(m_uniBlockNames.size());
+        for (size_t i=0 ; i<m_uniBlockNames.size() ; ++i)
         {
-            glEnable(GL_BLEND);
-            glBlendFunc(m_sfactor, m_dfactor);
+            GLint uniLoc = glGetUniformBlockIndex(m_prog, m_uniBlockNames[i].c_str());
+            //if (uniLoc < 0)
+            //    Log.report(logvisor::Warning, "unable to find uniform block '%s'", m_uniBlockNames[i].c_str());
+            /* Block bindings are program state; fix them to slot i once here */
+            if (uniLoc >= 0)
+                glUniformBlockBinding(m_prog, uniLoc, i);
+            m_uniLocs.push_back(uniLoc);
         }
-        else
-            glDisable(GL_BLEND);
 
-        if (m_depthTest)
-            glEnable(GL_DEPTH_TEST);
-        else
-            glDisable(GL_DEPTH_TEST);
-        glDepthMask(m_depthWrite);
-        glDepthFunc(GL_LEQUAL);
+        for (size_t i=0 ; i<m_texNames.size() ; ++i)
+        {
+            GLint texLoc = glGetUniformLocation(m_prog, m_texNames[i].c_str());
+            if (texLoc < 0)
+            { /* Log.report(logvisor::Warning, "unable to find sampler variable '%s'", m_texNames[i].c_str()); */ }
+            else
+                glUniform1i(texLoc, i);
+        }
 
-        if (m_culling != CullMode::None)
+        glUseProgram(prevProg);
+        m_linkState.store(LinkState::Ready, std::memory_order_release);
+        return true;
+    }
+
+    bool isReady() const
+    {
+        LinkState state = m_linkState.load(std::memory_order_acquire);
+        if (state != LinkState::Pending)
+            return state == LinkState::Ready;
+        if (GLEW_ARB_parallel_shader_compile)
         {
-            glEnable(GL_CULL_FACE);
-            glCullFace(m_culling == CullMode::Backface ? GL_BACK : GL_FRONT);
+            GLint done = GL_FALSE;
+            glGetProgramiv(m_prog, GL_COMPLETION_STATUS_ARB, &done);
+            if (done != GL_TRUE)
+                return false;
         }
-        else
-            glDisable(GL_CULL_FACE);
+        return _resolve();
+    }
+};
 
-        return m_prog;
+void GLProgramRegistry::_storePendingBinaries()
+{
+    std::unique_lock<std::recursive_mutex> lk(m_lock);
+    for (auto& prog : m_programs)
+    {
+        GLShareableProgram& p = *prog.second;
+        if (p.m_storePending.exchange(false, std::memory_order_acquire))
+            p.m_cache->store(p.m_cacheKey, p.m_prog);
+    }
+}
+
+void GLProgramRegistry::_unregisterShareableShader(uint64_t srcKey, uint64_t binKey)
+{
+    std::unique_lock<std::recursive_mutex> lk(m_lock);
+    auto search = m_programs.find(srcKey);
+    if (search != m_programs.end() && search->second->expired())
+        m_programs.erase(search);
+}
+
+class GLShaderPipeline : public IShaderPipeline
+{
+    friend class GLDataFactory;
+    friend struct GLCommandQueue;
+    friend struct GLShaderDataBinding;
+    GLShareableProgram::Token m_program;
+    GLenum m_sfactor = GL_ONE;
+    GLenum m_dfactor = GL_ZERO;
+    GLenum m_drawPrim = GL_TRIANGLES;
+    bool m_depthTest = true;
+    bool m_depthWrite = true;
+    CullMode m_culling;
+    GLShaderPipeline() = default;
+public:
+    GLShaderPipeline& operator=(const GLShaderPipeline&) = delete;
+    GLShaderPipeline(const GLShaderPipeline&) = delete;
+
+    const GLShareableProgram& program() const {return m_program.get();}
+    bool isReady() const {return m_program.get().isReady();}
+
+    /* False while the program is still compiling or failed to link; the caller
+     * then skips draws rather than issue them without a valid program */
+    bool bind(GLStateCache& st) const
+    {
+        const GLShareableProgram& prog = m_program.get();
+        if (!prog.isReady())
+            return false;
+        st.useProgram(prog.m_prog);
+        st.setBlend(m_sfactor, m_dfactor);
+        st.setDepthTest(m_depthTest);
+        st.setDepthWrite(m_depthWrite);
+        st.setDepthFunc(GL_LEQUAL);
+        st.setCulling(m_culling);
+        return true;
     }
 };
 
@@ -502,7 +1193,14 @@ IShaderPipeline* GLDataFactory::Context::newShaderPipeline
  bool depthTest, bool depthWrite, CullMode culling)
 {
     GLDataFactoryImpl& factory = static_cast<GLDataFactoryImpl&>(m_parent);
-    GLShaderPipeline shader;
+
+    /* Let the driver spread compiles across as many threads as it likes */
+    if (factory.m_compilerThreadsSet.get() != &factory)
+    {
+        if (GLEW_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xffffffff);
+        factory.m_compilerThreadsSet.reset(&factory);
+    }
 
     XXH64_state_t hashState;
     uint64_t hashes[2];
@@ -513,131 +1211,136 @@ IShaderPipeline* GLDataFactory::Context::newShaderPipeline
     XXH64_update(&hashState, fragSource, strlen(fragSource));
     hashes[1] = XXH64_digest(&hashState);
 
-    GLint status;
-    auto vertFind = factory.m_sharedShaders.find(hashes[0]);
-    if (vertFind != factory.m_sharedShaders.end())
+    /* Blend, depth, cull and primitive are applied per bind, so the program
+     * is keyed only on what gets baked into it at link time */
+    XXH64_reset(&hashState, 0);
+    XXH64_update(&hashState, hashes, sizeof(hashes));
+    for (size_t i=0 ; i<uniformBlockCount ; ++i)
+        XXH64_update(&hashState, uniformBlockNames[i], strlen(uniformBlockNames[i]) + 1);
+    XXH64_update(&hashState, "", 1);
+    for (size_t i=0 ; texNames && i<texCount ; ++i)
+        XXH64_update(&hashState, texNames[i], strlen(texNames[i]) + 1);
+    uint64_t progKey = XXH64_digest(&hashState);
+
+    std::unique_lock<std::recursive_mutex> sharedLk(factory.m_sharedLock);
+    GLShareableProgram::Token program;
+    auto progFind = factory.m_sharedPrograms.m_programs.find(progKey);
+    if (progFind != factory.m_sharedPrograms.m_programs.end())
     {
-        shader.m_vert = vertFind->second->lock();
+        program = progFind->second->lock();
     }
     else
     {
-        GLuint sobj = glCreateShader(GL_VERTEX_SHADER);
-        if (!sobj)
-        {
-            Log.report(logvisor::Error, "unable to create vert shader");
-            return nullptr;
-        }
+        std::unique_ptr<GLShareableProgram> prog(new GLShareableProgram(factory.m_sharedPrograms, progKey));
 
-        glShaderSource(sobj, 1, &vertSource, nullptr);
-        glCompileShader(sobj);
-        glGetShaderiv(sobj, GL_COMPILE_STATUS, &status);
-        if (status != GL_TRUE)
-        {
-            GLint logLen;
-            glGetShaderiv(sobj, GL_INFO_LOG_LENGTH, &logLen);
-            char* log = (char*)malloc(logLen);
-            glGetShaderInfoLog(sobj, logLen, nullptr, log);
-            Log.report(logvisor::Error, "unable to compile vert source\n%s\n%s\n", log, vertSource);
-            free(log);
-            return nullptr;
-        }
-
-        auto it =
-        factory.m_sharedShaders.emplace(std::make_pair(hashes[0],
-            std::make_unique<GLShareableShader>(factory, hashes[0], sobj))).first;
-        shader.m_vert = it->second->lock();
-    }
-    auto fragFind = factory.m_sharedShaders.find(hashes[1]);
-    if (fragFind != factory.m_sharedShaders.end())
-    {
-        shader.m_frag = fragFind->second->lock();
-    }
-    else
-    {
-        GLuint sobj = glCreateShader(GL_FRAGMENT_SHADER);
-        if (!sobj)
+        /* Program binaries are additionally keyed on the driver */
+        uint64_t binKey = 0;
+        if (factory.m_programCache.enabled())
         {
-            Log.report(logvisor::Error, "unable to create frag shader");
-            return nullptr;
+            XXH64_reset(&hashState, factory.m_programCache.driverHash());
+            XXH64_update(&hashState, &progKey, sizeof(progKey));
+            binKey = XXH64_digest(&hashState);
+            prog->m_prog = factory.m_programCache.load(binKey);
         }
 
-        glShaderSource(sobj, 1, &fragSource, nullptr);
-        glCompileShader(sobj);
-        glGetShaderiv(sobj, GL_COMPILE_STATUS, &status);
-        if (status != GL_TRUE)
+        bool fromCache = prog->m_prog != 0;
+        if (!fromCache)
         {
-            GLint logLen;
-            glGetShaderiv(sobj, GL_INFO_LOG_LENGTH, &logLen);
-            char* log = (char*)malloc(logLen);
-            glGetShaderInfoLog(sobj, logLen, nullptr, log);
-            Log.report(logvisor::Error, "unable to compile frag source\n%s\n%s\n", log, fragSource);
-            free(log);
-            return nullptr;
-        }
+            /* Compile and link are only issued here; status is checked in _resolve()
+             * so a transaction's programs build concurrently in the driver */
+            auto vertFind = factory.m_sharedShaders.find(hashes[0]);
+            if (vertFind != factory.m_sharedShaders.end())
+            {
+                prog->m_vert = vertFind->second->lock();
+            }
+            else
+            {
+                GLuint sobj = glCreateShader(GL_VERTEX_SHADER);
+                if (!sobj)
+                {
+                    Log.report(logvisor::Error, "unable to create vert shader");
+                    return nullptr;
+                }
 
-        auto it =
-        factory.m_sharedShaders.emplace(std::make_pair(hashes[1],
-            std::make_unique<GLShareableShader>(factory, hashes[1], sobj))).first;
-        shader.m_frag = it->second->lock();
-    }
+                glShaderSource(sobj, 1, &vertSource, nullptr);
+                glCompileShader(sobj);
 
-    shader.m_prog = glCreateProgram();
-    if (!shader.m_prog)
-    {
-        Log.report(logvisor::Error, "unable to create shader program");
-        return nullptr;
-    }
+                auto it =
+                factory.m_sharedShaders.emplace(std::make_pair(hashes[0],
+                    std::make_unique<GLShareableShader>(factory, hashes[0], sobj))).first;
+                prog->m_vert = it->second->lock();
+            }
+            auto fragFind = factory.m_sharedShaders.find(hashes[1]);
+            if (fragFind != factory.m_sharedShaders.end())
+            {
+                prog->m_frag = fragFind->second->lock();
+            }
+            else
+            {
+                GLuint sobj = glCreateShader(GL_FRAGMENT_SHADER);
+                if (!sobj)
+                {
+                    Log.report(logvisor::Error, "unable to create frag shader");
+                    return nullptr;
+                }
 
-    glAttachShader(shader.m_prog, shader.m_vert.get().m_shader);
-    glAttachShader(shader.m_prog, shader.m_frag.get().m_shader);
+                glShaderSource(sobj, 1, &fragSource, nullptr);
+                glCompileShader(sobj);
 
-    glLinkProgram(shader.m_prog);
-    glGetProgramiv(shader.m_prog, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE)
-    {
-        GLint logLen;
-        glGetProgramiv(shader.m_prog, GL_INFO_LOG_LENGTH, &logLen);
-        char* log = (char*)malloc(logLen);
-        glGetProgramInfoLog(shader.m_prog, logLen, nullptr, log);
-        Log.report(logvisor::Error, "unable to link shader program\n%s\n", log);
-        free(log);
-        return nullptr;
-    }
+                auto it =
+                factory.m_sharedShaders.emplace(std::make_pair(hashes[1],
+                    std::make_unique<GLShareableShader>(factory, hashes[1], sobj))).first;
+                prog->m_frag = it->second->lock();
+            }
+
+            prog->m_prog = glCreateProgram();
+            if (!prog->m_prog)
+            {
+                Log.report(logvisor::Error, "unable to create shader program");
+                return nullptr;
+            }
 
-    glUseProgram(shader.m_prog);
+            glAttachShader(prog->m_prog, prog->m_vert.get().m_shader);
+            glAttachShader(prog->m_prog, prog->m_frag.get().m_shader);
 
-    if (uniformBlockCount)
-    {
-        shader.m_uniLocs.reserve(uniformBlockCount);
-        for (size_t i=0 ; i<uniformBlockCount ; ++i)
-        {
-            GLint uniLoc = glGetUniformBlockIndex(shader.m_prog, uniformBlockNames[i]);
-            //if (uniLoc < 0)
-            //    Log.report(logvisor::Warning, "unable to find uniform block '%s'", uniformBlockNames[i]);
-            shader.m_uniLocs.push_back(uniLoc);
+            if (factory.m_programCache.enabled())
+            {
+                glProgramParameteri(prog->m_prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+                prog->m_cache = &factory.m_programCache;
+                prog->m_cacheKey = binKey;
+            }
+            glLinkProgram(prog->m_prog);
         }
-    }
 
-    if (texCount && texNames)
-    {
-        for (int i=0 ; i<texCount ; ++i)
+        prog->m_uniBlockNames.reserve(uniformBlockCount);
+        for (size_t i=0 ; i<uniformBlockCount ; ++i)
+            prog->m_uniBlockNames.emplace_back(uniformBlockNames[i]);
+        if (texNames)
         {
-            GLint texLoc = glGetUniformLocation(shader.m_prog, texNames[i]);
-            if (texLoc < 0)
-            { /* Log.report(logvisor::Warning, "unable to find sampler variable '%s'", texNames[i]); */ }
-            else
-                glUniform1i(texLoc, i);
+            prog->m_texNames.reserve(texCount);
+            for (size_t i=0 ; i<texCount ; ++i)
+                prog->m_texNames.emplace_back(texNames[i]);
         }
-    }
 
-    shader.m_sfactor = BLEND_FACTOR_TABLE[int(srcFac)];
-    shader.m_dfactor = BLEND_FACTOR_TABLE[int(dstFac)];
-    shader.m_depthTest = depthTest;
-    shader.m_depthWrite = depthWrite;
-    shader.m_culling = culling;
-    shader.m_drawPrim = PRIMITIVE_TABLE[int(prim)];
+        /* Cached binaries are already linked; nothing is gained by deferring them */
+        if (fromCache)
+            prog->_resolve();
 
-    GLShaderPipeline* retval = new GLShaderPipeline(std::move(shader));
+        auto it = factory.m_sharedPrograms.m_programs.emplace(std::make_pair(progKey, std::move(prog))).first;
+        program = it->second->lock();
+    }
+    sharedLk.unlock();
+
+    std::unique_ptr<GLShaderPipeline> shader(new GLShaderPipeline);
+    shader->m_program = std::move(program);
+    shader->m_sfactor = BLEND_FACTOR_TABLE[int(srcFac)];
+    shader->m_dfactor = BLEND_FACTOR_TABLE[int(dstFac)];
+    shader->m_depthTest = depthTest;
+    shader->m_depthWrite = depthWrite;
+    shader->m_culling = culling;
+    shader->m_drawPrim = PRIMITIVE_TABLE[int(prim)];
+
+    GLShaderPipeline* retval = shader.release();
     GLDataFactoryImpl::m_deferredData->m_SPs.emplace_back(retval);
     return retval;
 }
@@ -653,7 +1356,7 @@ struct GLVertexFormat : IVertexFormat
                    const VertexElementDescriptor* elements,
                    size_t baseVert, size_t baseInst);
     ~GLVertexFormat();
-    void bind(int idx) const {glBindVertexArray(m_vao[idx]);}
+    void bind(GLStateCache& st, int idx) const {st.bindVertexArray(m_vao[idx]);}
 };
 
 struct GLShaderDataBinding : IShaderDataBindingPriv<GLData>
@@ -666,6 +1369,9 @@ struct GLShaderDataBinding : IShaderDataBindingPriv<GLData>
     size_t m_texCount;
     std::unique_ptr<ITexture*[]> m_texs;
 
+    /* Frame in which GLCommandQueue last took a keep-alive token (client thread only) */
+    uint64_t m_recordSerial = 0;
+
     GLShaderDataBinding(GLData* d,
                         IShaderPipeline* pipeline,
                         IVertexFormat* vtxFormat,
@@ -682,14 +1388,16 @@ struct GLShaderDataBinding : IShaderDataBindingPriv<GLData>
     {
         if (ubufOffs && ubufSizes)
         {
+            size_t align = UniformOffsetAlignment();
             m_ubufOffs.reserve(ubufCount);
             for (size_t i=0 ; i<ubufCount ; ++i)
             {
 #ifndef NDEBUG
-                if (ubufOffs[i] % 256)
-                    Log.report(logvisor::Fatal, "non-256-byte-aligned uniform-offset %d provided to newShaderDataBinding", int(i));
+                if (ubufOffs[i] % align)
+                    Log.report(logvisor::Fatal, "non-%d-byte-aligned uniform-offset %d provided to newShaderDataBinding",
+                               int(align), int(i));
 #endif
-                m_ubufOffs.emplace_back(ubufOffs[i], (ubufSizes[i] + 255) & ~255);
+                m_ubufOffs.emplace_back(ubufOffs[i], (ubufSizes[i] + align - 1) / align * align);
             }
         }
         for (size_t i=0 ; i<ubufCount ; ++i)
@@ -703,39 +1411,42 @@ struct GLShaderDataBinding : IShaderDataBindingPriv<GLData>
         for (size_t i=0 ; i<texCount ; ++i)
             m_texs[i] = texs[i];
     }
-    void bind(int b) const
+    bool bind(GLStateCache& st, int b, const size_t* dynOffs=nullptr, size_t dynOffCount=0) const
     {
-        GLuint prog = m_pipeline->bind();
-        m_vtxFormat->bind(b);
+        if (!m_pipeline->bind(st))
+            return false;
+        m_vtxFormat->bind(st, b);
         if (m_ubufOffs.size())
         {
-            for (size_t i=0 ; i<m_ubufCount && i<m_pipeline->m_uniLocs.size() ; ++i)
+            for (size_t i=0 ; i<m_ubufCount && i<m_pipeline->program().m_uniLocs.size() ; ++i)
             {
-                GLint loc = m_pipeline->m_uniLocs[i];
+                GLint loc = m_pipeline->program().m_uniLocs[i];
                 if (loc < 0)
                     continue;
                 IGraphicsBuffer* ubuf = m_ubufs[i];
                 const std::pair<size_t,size_t>& offset = m_ubufOffs[i];
                 if (ubuf->dynamic())
-                    static_cast<GLGraphicsBufferD*>(ubuf)->bindUniformRange(i, offset.first, offset.second, b);
+                {
+                    GLGraphicsBufferD* dbuf = static_cast<GLGraphicsBufferD*>(ubuf);
+                    size_t dynOff = (dbuf->m_transient && i < dynOffCount) ? dynOffs[i] : 0;
+                    dbuf->bindUniformRange(st, i, offset.first + dynOff, offset.second, b);
+                }
                 else
-                    static_cast<GLGraphicsBufferS*>(ubuf)->bindUniformRange(i, offset.first, offset.second);
-                glUniformBlockBinding(prog, loc, i);
+                    static_cast<GLGraphicsBufferS*>(ubuf)->bindUniformRange(st, i, offset.first, offset.second);
             }
         }
         else
         {
-            for (size_t i=0 ; i<m_ubufCount && i<m_pipeline->m_uniLocs.size() ; ++i)
+            for (size_t i=0 ; i<m_ubufCount && i<m_pipeline->program().m_uniLocs.size() ; ++i)
             {
-                GLint loc = m_pipeline->m_uniLocs[i];
+                GLint loc = m_pipeline->program().m_uniLocs[i];
                 if (loc < 0)
                     continue;
                 IGraphicsBuffer* ubuf = m_ubufs[i];
                 if (ubuf->dynamic())
-                    static_cast<GLGraphicsBufferD*>(ubuf)->bindUniform(i, b);
+                    static_cast<GLGraphicsBufferD*>(ubuf)->bindUniform(st, i, b);
                 else
-                    static_cast<GLGraphicsBufferS*>(ubuf)->bindUniform(i);
-                glUniformBlockBinding(prog, loc, i);
+                    static_cast<GLGraphicsBufferS*>(ubuf)->bindUniform(st, i);
             }
         }
         for (size_t i=0 ; i<m_texCount ; ++i)
@@ -746,21 +1457,22 @@ struct GLShaderDataBinding : IShaderDataBindingPriv<GLData>
                 switch (tex->type())
                 {
                 case TextureType::Dynamic:
-                    static_cast<GLTextureD*>(tex)->bind(i, b);
+                    static_cast<GLTextureD*>(tex)->bind(st, i, b);
                     break;
                 case TextureType::Static:
-                    static_cast<GLTextureS*>(tex)->bind(i);
+                    static_cast<GLTextureS*>(tex)->bind(st, i);
                     break;
                 case TextureType::StaticArray:
-                    static_cast<GLTextureSA*>(tex)->bind(i);
+                    static_cast<GLTextureSA*>(tex)->bind(st, i);
                     break;
                 case TextureType::Render:
-                    static_cast<GLTextureR*>(tex)->bind(i);
+                    static_cast<GLTextureR*>(tex)->bind(st, i);
                     break;
                 default: break;
                 }
             }
         }
+        return true;
     }
 };
 
@@ -785,6 +1497,7 @@ GLDataFactoryImpl::GLDataFactoryImpl(IGraphicsContext* parent, uint32_t drawSamp
 
 GraphicsDataToken GLDataFactoryImpl::commitTransaction(const FactoryCommitFunc& trans)
 {
+    BOO_TRACE_ZONE("GL commitTransaction");
     if (m_deferredData.get())
         Log.report(logvisor::Fatal, "nested commitTransaction usage detected");
     m_deferredData.reset(new GLData());
@@ -797,16 +1510,26 @@ GraphicsDataToken GLDataFactoryImpl::commitTransaction(const FactoryCommitFunc&
         return GraphicsDataToken(this, nullptr);
     }
 
+    /* Read back binaries of programs linked since the last commit here, on a
+       load context, rather than stall the render thread that resolved them */
+    if (m_programCache.enabled())
+        m_sharedPrograms._storePendingBinaries();
+
+    /* Fence the uploads instead of relying on a bare glFlush; this may run on any
+       of several load contexts, so flush before publishing the fence - another
+       context may only wait on a sync object once its command has been flushed */
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
     std::unique_lock<std::mutex> lk(m_committedMutex);
     GLData* retval = m_deferredData.get();
     m_deferredData.reset();
     m_committedData.insert(retval);
-
-    lk.unlock();
-    /* Let's go ahead and flush to ensure our data gets to the GPU
-       While this isn't strictly required, some drivers might behave
-       differently */
-    glFlush();
+    for (std::unique_ptr<GLGraphicsBufferD>& b : retval->m_DBufs)
+        b->attachDirtyList(m_dirtyResources);
+    for (std::unique_ptr<GLTextureD>& t : retval->m_DTexs)
+        t->attachDirtyList(m_dirtyResources);
+    m_uploadFences.push_back(fence);
     return GraphicsDataToken(this, retval);
 }
 
@@ -845,15 +1568,6 @@ void GLDataFactoryImpl::destroyPool(IGraphicsBufferPool* p)
     delete pool;
 }
 
-IGraphicsBufferD* GLDataFactoryImpl::newPoolBuffer(IGraphicsBufferPool* p, BufferUse use,
-                                                   size_t stride, size_t count)
-{
-    GLPool* pool = static_cast<GLPool*>(p);
-    GLGraphicsBufferD* retval = new GLGraphicsBufferD(use, stride * count);
-    pool->m_DBufs.emplace(std::make_pair(retval, std::unique_ptr<GLGraphicsBufferD>(retval)));
-    return retval;
-}
-
 void GLDataFactoryImpl::deletePoolBuffer(IGraphicsBufferPool *p, IGraphicsBufferD *buf)
 {
     GLPool* pool = static_cast<GLPool*>(p);
@@ -911,58 +1625,134 @@ struct GLCommandQueue : IGraphicsCommandQueue
     const SystemChar* platformName() const {return _S("OpenGL");}
     IGraphicsContext* m_parent = nullptr;
 
-    struct Command
-    {
-        enum class Op
-        {
-            SetShaderDataBinding,
-            SetRenderTarget,
-            SetViewport,
-            SetScissor,
-            SetClearColor,
-            ClearTarget,
-            Draw,
-            DrawIndexed,
-            DrawInstances,
-            DrawInstancesIndexed,
-            ResolveBindTexture,
-            Present
-        } m_op;
-        union
-        {
-            const IShaderDataBinding* binding;
-            const ITextureR* target;
-            const ITextureR* source;
-            struct
-            {
-                SWindowRect rect;
-                float znear, zfar;
-            } viewport;
-            float rgba[4];
-            GLbitfield flags;
-            struct
-            {
-                size_t start;
-                size_t count;
-                size_t instCount;
-            };
-        };
-        IShaderDataBindingPriv<GLData>::Token resToken;
-        const ITextureR* resolveTex;
-        bool resolveColor : 1;
-        bool resolveDepth : 1;
-        Command(Op op) : m_op(op) {}
-        Command(const Command&) = delete;
-        Command& operator=(const Command&) = delete;
-        Command(Command&&) = default;
-        Command& operator=(Command&&) = default;
+    /* Touched only by RenderingWorker */
+    GLStateCache m_glState;
+
+    /* Commands are packed into a byte stream: an Op byte followed by that op's
+     * payload struct (copied unaligned), so replay is a linear decode. Shader
+     * data bindings are kept alive by one token per binding per frame */
+    enum class Op : uint8_t
+    {
+        SetShaderDataBinding,
+        SetRenderTarget,
+        SetViewport,
+        SetScissor,
+        SetClearColor,
+        ClearTarget,
+        Draw,
+        DrawIndexed,
+        DrawInstances,
+        DrawInstancesIndexed,
+        DrawIndirect,
+        DrawIndexedIndirect,
+        ResolveBindTexture,
+        Present
+    };
+    struct CmdBinding
+    {
+        const GLShaderDataBinding* binding;
+        uint8_t dynOffCount; /* followed by dynOffCount uint32_t offsets */
+    };
+    struct CmdViewport
+    {
+        SWindowRect rect;
+        float znear, zfar;
+    };
+    struct CmdDraw
+    {
+        uint32_t start;
+        uint32_t count;
+    };
+    struct CmdDrawInstances
+    {
+        uint32_t start;
+        uint32_t count;
+        uint32_t instCount;
+    };
+    struct CmdDrawIndirect
+    {
+        const IGraphicsBuffer* buf;
+        uint32_t offset;
+        uint32_t drawCount; /* Upper bound when countBuf is set */
+        const IGraphicsBuffer* countBuf;
+        uint32_t countOffset;
+    };
+    struct CmdResolve
+    {
+        const GLTextureR* tex;
+        SWindowRect rect;
+        bool color;
+        bool depth;
+    };
+
+    struct CommandBuffer
+    {
+        std::vector<uint8_t> m_stream;
+        std::vector<IShaderDataBindingPriv<GLData>::Token> m_resTokens;
+
+        uint8_t* _append(size_t sz)
+        {
+            size_t off = m_stream.size();
+            m_stream.resize(off + sz);
+            return m_stream.data() + off;
+        }
+        void push(Op op)
+        {
+            *_append(1) = uint8_t(op);
+        }
+        template <class T>
+        void push(Op op, const T& payload)
+        {
+            uint8_t* ptr = _append(1 + sizeof(T));
+            *ptr = uint8_t(op);
+            memcpy(ptr + 1, &payload, sizeof(T));
+        }
+        void clear()
+        {
+            m_stream.clear();
+            m_resTokens.clear();
+        }
     };
-    std::vector<Command> m_cmdBufs[3];
+
+    template <class T>
+    static T ReadCmd(const uint8_t*& ptr)
+    {
+        T ret;
+        memcpy(&ret, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return ret;
+    }
+
+    CommandBuffer m_cmdBufs[3];
+
+    /* Incremented per execute(); bindings record the frame that last took a token */
+    uint64_t m_frameSerial = 1;
     size_t m_fillBuf = 0;
     size_t m_completeBuf = 0;
     size_t m_drawBuf = 0;
     bool m_running = true;
 
+    /* Signalled once the GPU finishes the frame that last read each buffer slot;
+     * persistently mapped dynamic buffers wait on these before writing a slot */
+    std::mutex m_fenceMt;
+    GLsync m_slotFences[3] = {};
+
+    size_t fillSlot() const {return m_fillBuf;}
+
+    void waitSlotFence(size_t b)
+    {
+        GLsync fence;
+        {
+            std::unique_lock<std::mutex> lk(m_fenceMt);
+            fence = m_slotFences[b];
+            m_slotFences[b] = 0;
+        }
+        if (!fence)
+            return;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+    }
+
     std::mutex m_mt;
     std::condition_variable m_cv;
     std::mutex m_initmt;
@@ -1054,8 +1844,116 @@ struct GLCommandQueue : IGraphicsCommandQueue
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex->m_texs[1], 0);
     }
 
+    static GLuint IndirectBufferName(const IGraphicsBuffer* buf, int b)
+    {
+        if (buf->dynamic())
+            return static_cast<const GLGraphicsBufferD*>(buf)->m_bufs[b];
+        return static_cast<const GLGraphicsBufferS*>(buf)->m_buf;
+    }
+
+    /* Pre-4.0 contexts: read the records back and issue them as direct draws
+     * (firstInstance is honored only with ARB_base_instance, as with real indirect draws) */
+    static void EmulateDrawIndirect(GLenum prim, bool indexed, GLuint buf, uint32_t offset, uint32_t drawCount)
+    {
+        size_t stride = indexed ? sizeof(DrawIndexedIndirectCommand) : sizeof(DrawIndirectCommand);
+        std::unique_ptr<uint8_t[]> args(new uint8_t[drawCount * stride]);
+        glBindBuffer(GL_COPY_READ_BUFFER, buf);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, offset, drawCount * stride, args.get());
+
+        for (uint32_t i=0 ; i<drawCount ; ++i)
+        {
+            if (indexed)
+            {
+                DrawIndexedIndirectCommand rec;
+                memcpy(&rec, args.get() + i * stride, stride);
+                if (!rec.instanceCount)
+                    continue;
+                void* first = reinterpret_cast<void*>(size_t(rec.firstIndex) * 4);
+                if (rec.firstInstance && GLEW_ARB_base_instance)
+                    glDrawElementsInstancedBaseVertexBaseInstance(prim, rec.indexCount, GL_UNSIGNED_INT, first,
+                                                                  rec.instanceCount, rec.vertexOffset,
+                                                                  rec.firstInstance);
+                else
+                    glDrawElementsInstancedBaseVertex(prim, rec.indexCount, GL_UNSIGNED_INT, first,
+                                                      rec.instanceCount, rec.vertexOffset);
+            }
+            else
+            {
+                DrawIndirectCommand rec;
+                memcpy(&rec, args.get() + i * stride, stride);
+                if (!rec.instanceCount)
+                    continue;
+                if (rec.firstInstance && GLEW_ARB_base_instance)
+                    glDrawArraysInstancedBaseInstance(prim, rec.firstVertex, rec.vertexCount,
+                                                      rec.instanceCount, rec.firstInstance);
+                else
+                    glDrawArraysInstanced(prim, rec.firstVertex, rec.vertexCount, rec.instanceCount);
+            }
+        }
+    }
+
+    /* One driver call with ARB_multi_draw_indirect, otherwise one per record.
+     * A count buffer is consumed by the GPU with ARB_indirect_parameters,
+     * otherwise read back and clamped here */
+    static void DrawIndirect(GLenum prim, bool indexed, const CmdDrawIndirect& cmd, int b)
+    {
+        GLuint buf = IndirectBufferName(cmd.buf, b);
+        uint32_t drawCount = cmd.drawCount;
+        if (cmd.countBuf)
+        {
+            GLuint countBuf = IndirectBufferName(cmd.countBuf, b);
+            if (GLEW_ARB_indirect_parameters)
+            {
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buf);
+                glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuf);
+                if (indexed)
+                    glMultiDrawElementsIndirectCountARB(prim, GL_UNSIGNED_INT, reinterpret_cast<void*>(size_t(cmd.offset)),
+                                                        GLintptr(cmd.countOffset), cmd.drawCount, 0);
+                else
+                    glMultiDrawArraysIndirectCountARB(prim, reinterpret_cast<void*>(size_t(cmd.offset)),
+                                                      GLintptr(cmd.countOffset), cmd.drawCount, 0);
+                return;
+            }
+
+            uint32_t count = 0;
+            glBindBuffer(GL_COPY_READ_BUFFER, countBuf);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, cmd.countOffset, sizeof(count), &count);
+            drawCount = std::min(count, cmd.drawCount);
+        }
+        if (!drawCount)
+            return;
+
+        if (!HasDrawIndirect())
+        {
+            EmulateDrawIndirect(prim, indexed, buf, cmd.offset, drawCount);
+            return;
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buf);
+        if (indexed)
+        {
+            if (GLEW_ARB_multi_draw_indirect)
+                glMultiDrawElementsIndirect(prim, GL_UNSIGNED_INT, reinterpret_cast<void*>(size_t(cmd.offset)),
+                                            drawCount, 0);
+            else
+                for (uint32_t i=0 ; i<drawCount ; ++i)
+                    glDrawElementsIndirect(prim, GL_UNSIGNED_INT, reinterpret_cast<void*>(
+                        cmd.offset + i * sizeof(DrawIndexedIndirectCommand)));
+        }
+        else
+        {
+            if (GLEW_ARB_multi_draw_indirect)
+                glMultiDrawArraysIndirect(prim, reinterpret_cast<void*>(size_t(cmd.offset)), drawCount, 0);
+            else
+                for (uint32_t i=0 ; i<drawCount ; ++i)
+                    glDrawArraysIndirect(prim, reinterpret_cast<void*>(
+                        cmd.offset + i * sizeof(DrawIndirectCommand)));
+        }
+    }
+
     static void RenderingWorker(GLCommandQueue* self)
     {
+        BOO_TRACE_THREAD_NAME("boo GL Render");
         {
             std::unique_lock<std::mutex> lk(self->m_initmt);
             self->m_parent->makeCurrent();
@@ -1074,8 +1972,20 @@ struct GLCommandQueue : IGraphicsCommandQueue
                 self->m_cv.wait(lk);
                 if (!self->m_running)
                     break;
+                BOO_TRACE_ZONE("GL Pending Ops");
                 self->m_drawBuf = self->m_completeBuf;
 
+                {
+                    GLDataFactoryImpl* gfxF = static_cast<GLDataFactoryImpl*>(self->m_parent->getDataFactory());
+                    std::unique_lock<std::mutex> flk(gfxF->m_committedMutex);
+                    for (GLsync fence : gfxF->m_uploadFences)
+                    {
+                        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+                        glDeleteSync(fence);
+                    }
+                    gfxF->m_uploadFences.clear();
+                }
+
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
                 if (self->m_pendingFboAdds.size())
@@ -1116,90 +2026,141 @@ struct GLCommandQueue : IGraphicsCommandQueue
                 if (self->m_pendingPosts2.size())
                     posts.swap(self->m_pendingPosts2);
             }
-            std::vector<Command>& cmds = self->m_cmdBufs[self->m_drawBuf];
+            BOO_TRACE_ZONE("GL Replay");
+            GLStateCache& st = self->m_glState;
+            st.reset();
+            CommandBuffer& cmds = self->m_cmdBufs[self->m_drawBuf];
+            const uint8_t* ptr = cmds.m_stream.data();
+            const uint8_t* end = ptr + cmds.m_stream.size();
             GLenum currentPrim = GL_TRIANGLES;
-            for (const Command& cmd : cmds)
+            /* Set while the bound pipeline has no usable program */
+            bool skipDraws = false;
+            while (ptr < end)
             {
-                switch (cmd.m_op)
+                switch (Op(*ptr++))
                 {
-                case Command::Op::SetShaderDataBinding:
+                case Op::SetShaderDataBinding:
                 {
-                    const GLShaderDataBinding* binding = static_cast<const GLShaderDataBinding*>(cmd.binding);
-                    binding->bind(self->m_drawBuf);
-                    currentPrim = binding->m_pipeline->m_drawPrim;
+                    CmdBinding cmd = ReadCmd<CmdBinding>(ptr);
+                    size_t dynOffs[BOO_GLSL_MAX_UNIFORM_COUNT];
+                    for (size_t i=0 ; i<cmd.dynOffCount ; ++i)
+                        dynOffs[i] = ReadCmd<uint32_t>(ptr);
+                    skipDraws = !cmd.binding->bind(st, self->m_drawBuf, dynOffs, cmd.dynOffCount);
+                    currentPrim = cmd.binding->m_pipeline->m_drawPrim;
                     break;
                 }
-                case Command::Op::SetRenderTarget:
+                case Op::SetRenderTarget:
                 {
-                    const GLTextureR* tex = static_cast<const GLTextureR*>(cmd.target);
+                    const GLTextureR* tex = ReadCmd<const GLTextureR*>(ptr);
                     if (!tex)
                         glBindFramebuffer(GL_FRAMEBUFFER, 0);
                     else
                         glBindFramebuffer(GL_FRAMEBUFFER, tex->m_fbo);
                     break;
                 }
-                case Command::Op::SetViewport:
-                    glViewport(cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                               cmd.viewport.rect.size[0], cmd.viewport.rect.size[1]);
-                    glDepthRange(cmd.viewport.znear, cmd.viewport.zfar);
+                case Op::SetViewport:
+                {
+                    CmdViewport cmd = ReadCmd<CmdViewport>(ptr);
+                    glViewport(cmd.rect.location[0], cmd.rect.location[1],
+                               cmd.rect.size[0], cmd.rect.size[1]);
+                    glDepthRange(cmd.znear, cmd.zfar);
                     break;
-                case Command::Op::SetScissor:
-                    if (cmd.viewport.rect.size[0] == 0 && cmd.viewport.rect.size[1] == 0)
+                }
+                case Op::SetScissor:
+                {
+                    SWindowRect rect = ReadCmd<SWindowRect>(ptr);
+                    if (rect.size[0] == 0 && rect.size[1] == 0)
                         glDisable(GL_SCISSOR_TEST);
                     else
                     {
                         glEnable(GL_SCISSOR_TEST);
-                        glScissor(cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                                  cmd.viewport.rect.size[0], cmd.viewport.rect.size[1]);
+                        glScissor(rect.location[0], rect.location[1],
+                                  rect.size[0], rect.size[1]);
                     }
                     break;
-                case Command::Op::SetClearColor:
-                    glClearColor(cmd.rgba[0], cmd.rgba[1], cmd.rgba[2], cmd.rgba[3]);
+                }
+                case Op::SetClearColor:
+                {
+                    std::array<float, 4> rgba = ReadCmd<std::array<float, 4>>(ptr);
+                    glClearColor(rgba[0], rgba[1], rgba[2], rgba[3]);
                     break;
-                case Command::Op::ClearTarget:
-                    if (cmd.flags & GL_DEPTH_BUFFER_BIT)
-                        glDepthMask(GL_TRUE);
-                    glClear(cmd.flags);
+                }
+                case Op::ClearTarget:
+                {
+                    GLbitfield flags = ReadCmd<GLbitfield>(ptr);
+                    if (flags & GL_DEPTH_BUFFER_BIT)
+                        st.setDepthWrite(true);
+                    glClear(flags);
                     break;
-                case Command::Op::Draw:
+                }
+                case Op::Draw:
+                {
+                    CmdDraw cmd = ReadCmd<CmdDraw>(ptr);
+                    if (skipDraws)
+                        break;
                     glDrawArrays(currentPrim, cmd.start, cmd.count);
                     break;
-                case Command::Op::DrawIndexed:
+                }
+                case Op::DrawIndexed:
+                {
+                    CmdDraw cmd = ReadCmd<CmdDraw>(ptr);
+                    if (skipDraws)
+                        break;
                     glDrawElements(currentPrim, cmd.count, GL_UNSIGNED_INT,
-                                   reinterpret_cast<void*>(cmd.start * 4));
+                                   reinterpret_cast<void*>(size_t(cmd.start) * 4));
                     break;
-                case Command::Op::DrawInstances:
+                }
+                case Op::DrawInstances:
+                {
+                    CmdDrawInstances cmd = ReadCmd<CmdDrawInstances>(ptr);
+                    if (skipDraws)
+                        break;
                     glDrawArraysInstanced(currentPrim, cmd.start, cmd.count, cmd.instCount);
                     break;
-                case Command::Op::DrawInstancesIndexed:
+                }
+                case Op::DrawInstancesIndexed:
+                {
+                    CmdDrawInstances cmd = ReadCmd<CmdDrawInstances>(ptr);
+                    if (skipDraws)
+                        break;
                     glDrawElementsInstanced(currentPrim, cmd.count, GL_UNSIGNED_INT,
-                                            reinterpret_cast<void*>(cmd.start * 4), cmd.instCount);
+                                            reinterpret_cast<void*>(size_t(cmd.start) * 4), cmd.instCount);
+                    break;
+                }
+                case Op::DrawIndirect:
+                case Op::DrawIndexedIndirect:
+                {
+                    bool indexed = Op(ptr[-1]) == Op::DrawIndexedIndirect;
+                    CmdDrawIndirect cmd = ReadCmd<CmdDrawIndirect>(ptr);
+                    if (!skipDraws)
+                        DrawIndirect(currentPrim, indexed, cmd, self->m_drawBuf);
                     break;
-                case Command::Op::ResolveBindTexture:
+                }
+                case Op::ResolveBindTexture:
                 {
-                    const GLTextureR* tex = static_cast<const GLTextureR*>(cmd.resolveTex);
+                    CmdResolve cmd = ReadCmd<CmdResolve>(ptr);
+                    const GLTextureR* tex = cmd.tex;
                     GLenum target = (tex->m_samples > 1) ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
                     glBindFramebuffer(GL_READ_FRAMEBUFFER, tex->m_fbo);
-                    glActiveTexture(GL_TEXTURE9);
-                    if (cmd.resolveColor && tex->m_bindTexs[0])
+                    if (cmd.color && tex->m_bindTexs[0])
                     {
-                        glBindTexture(target, tex->m_bindTexs[0]);
-                        glCopyTexSubImage2D(target, 0, cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                                            cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                                            cmd.viewport.rect.size[0], cmd.viewport.rect.size[1]);
+                        st.bindTexture(9, target, tex->m_bindTexs[0]);
+                        glCopyTexSubImage2D(target, 0, cmd.rect.location[0], cmd.rect.location[1],
+                                            cmd.rect.location[0], cmd.rect.location[1],
+                                            cmd.rect.size[0], cmd.rect.size[1]);
                     }
-                    if (cmd.resolveDepth && tex->m_bindTexs[1])
+                    if (cmd.depth && tex->m_bindTexs[1])
                     {
-                        glBindTexture(target, tex->m_bindTexs[1]);
-                        glCopyTexSubImage2D(target, 0, cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                                            cmd.viewport.rect.location[0], cmd.viewport.rect.location[1],
-                                            cmd.viewport.rect.size[0], cmd.viewport.rect.size[1]);
+                        st.bindTexture(9, target, tex->m_bindTexs[1]);
+                        glCopyTexSubImage2D(target, 0, cmd.rect.location[0], cmd.rect.location[1],
+                                            cmd.rect.location[0], cmd.rect.location[1],
+                                            cmd.rect.size[0], cmd.rect.size[1]);
                     }
                     break;
                 }
-                case Command::Op::Present:
+                case Op::Present:
                 {
-                    const GLTextureR* tex = static_cast<const GLTextureR*>(cmd.source);
+                    const GLTextureR* tex = ReadCmd<const GLTextureR*>(ptr);
                     if (tex)
                     {
                         glBindFramebuffer(GL_READ_FRAMEBUFFER, tex->m_fbo);
@@ -1207,16 +2168,36 @@ struct GLCommandQueue : IGraphicsCommandQueue
                         glBlitFramebuffer(0, 0, tex->m_width, tex->m_height, 0, 0,
                                           tex->m_width, tex->m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
                     }
-                    self->m_parent->present();
+                    {
+                        BOO_TRACE_ZONE("GL Present");
+                        self->m_parent->present();
+                    }
                     break;
                 }
-                default: break;
+                default:
+                    Log.report(logvisor::Fatal, "corrupt GL command stream");
+                    break;
                 }
             }
+            {
+                GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                glFlush();
+                std::unique_lock<std::mutex> lk(self->m_fenceMt);
+                std::swap(self->m_slotFences[self->m_drawBuf], fence);
+                if (fence)
+                    glDeleteSync(fence);
+            }
             cmds.clear();
             for (auto& p : posts)
                 p();
         }
+
+        for (GLsync& fence : self->m_slotFences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
     }
 
     GLCommandQueue(IGraphicsContext* parent)
@@ -1238,37 +2219,165 @@ struct GLCommandQueue : IGraphicsCommandQueue
     ~GLCommandQueue()
     {
         if (m_running) stopRenderer();
+        for (GLsync& fence : m_texUploadFences)
+            if (fence)
+                glDeleteSync(fence);
+        if (m_texUploadBuf)
+            glDeleteBuffers(1, &m_texUploadBuf);
     }
 
     void setShaderDataBinding(IShaderDataBinding* binding)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::SetShaderDataBinding);
-        cmds.back().binding = binding;
-        cmds.back().resToken = static_cast<IShaderDataBindingPriv<GLData>*>(binding)->lock();
+        setShaderDataBindingDynamic(binding, nullptr, 0);
+    }
+
+    /* Transient uniforms: one ring region per command buffer slot, written in
+     * place when persistently mapped, otherwise uploaded from the shadow at execute() */
+    std::unique_ptr<GLGraphicsBufferD> m_transientBuf;
+    TransientUniformRing m_transientRing;
+    bool m_transientFenced = false;
+    /* Loader threads may fetch the buffer for bindings while the client allocates */
+    std::once_flag m_transientOnce;
+
+    GLGraphicsBufferD* _transientBuffer()
+    {
+        std::call_once(m_transientOnce, [this]()
+        {
+            m_transientBuf.reset(new GLGraphicsBufferD(this, BufferUse::Uniform, TransientUniformRing::FrameSize));
+            m_transientBuf->m_transient = true;
+            m_transientRing.init(TransientUniformRing::FrameSize, UniformOffsetAlignment());
+        });
+        return m_transientBuf.get();
+    }
+
+    IGraphicsBufferD* getTransientUniformBuffer() {return _transientBuffer();}
+
+    TransientUniform allocTransientUniform(size_t size)
+    {
+        GLGraphicsBufferD* buf = _transientBuffer();
+        TransientUniform ret;
+        if (!m_transientRing.alloc(size, ret.offset))
+        {
+            Log.report(logvisor::Error, "transient uniform ring exhausted (%d bytes requested)", int(size));
+            return {};
+        }
+        if (buf->persistent())
+        {
+            if (!m_transientFenced)
+            {
+                waitSlotFence(m_fillBuf);
+                m_transientFenced = true;
+            }
+            ret.data = buf->m_mapped[m_fillBuf] + ret.offset;
+        }
+        else
+            ret.data = buf->m_cpuBuf.get() + ret.offset;
+        return ret;
+    }
+
+    /* Dynamic texture uploads stage through one pixel-unpack segment per frame slot
+     * (persistently mapped, ARB_buffer_storage). A segment is rewritten only after
+     * the fence from its previous execute() signals, so uploads neither reallocate
+     * texture storage nor stall on in-flight copies */
+    static constexpr size_t TexUploadSegSize = 4 * 1024 * 1024;
+    GLuint m_texUploadBuf = 0;
+    uint8_t* m_texUploadMap = nullptr;
+    size_t m_texUploadHead = 0;
+    GLsync m_texUploadFences[3] = {};
+
+    uint8_t* _allocTexUpload(size_t sz, size_t& offsetOut)
+    {
+        if (!GLEW_ARB_buffer_storage || m_texUploadHead + sz > TexUploadSegSize)
+            return nullptr;
+        if (!m_texUploadBuf)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &m_texUploadBuf);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_texUploadBuf);
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, TexUploadSegSize * 3, nullptr, flags);
+            m_texUploadMap = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                                                    TexUploadSegSize * 3, flags));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        /* Dirty resources are updated for the slot just completed */
+        size_t seg = m_completeBuf;
+        if (!m_texUploadHead && m_texUploadFences[seg])
+        {
+            while (glClientWaitSync(m_texUploadFences[seg], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                    1000000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(m_texUploadFences[seg]);
+            m_texUploadFences[seg] = 0;
+        }
+        offsetOut = seg * TexUploadSegSize + m_texUploadHead;
+        m_texUploadHead = (m_texUploadHead + sz + 3) & ~size_t(3);
+        return m_texUploadMap + offsetOut;
+    }
+
+    /* Upload a rectangle of a tightly packed CPU image into the bound texture */
+    void _uploadTexRegion(GLenum format, size_t pxPitch, size_t texWidth, const uint8_t* src,
+                          const TextureDirtyRect& r)
+    {
+        size_t w = r.x1 - r.x0;
+        size_t h = r.y1 - r.y0;
+        size_t rowSz = w * pxPitch;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t offset;
+        if (uint8_t* dst = _allocTexUpload(rowSz * h, offset))
+        {
+            const uint8_t* srcRow = src + (r.y0 * texWidth + r.x0) * pxPitch;
+            for (size_t i=0 ; i<h ; ++i, dst += rowSz, srcRow += texWidth * pxPitch)
+                memcpy(dst, srcRow, rowSz);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_texUploadBuf);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, w, h, format, GL_UNSIGNED_BYTE,
+                            reinterpret_cast<void*>(offset));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+        {
+            /* No room in the segment (or no buffer storage); source from client memory */
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, texWidth);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, w, h, format, GL_UNSIGNED_BYTE, src);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void setShaderDataBindingDynamic(IShaderDataBinding* binding, const size_t* dynOffsets, size_t dynOffsetCount)
+    {
+        GLShaderDataBinding* cbind = static_cast<GLShaderDataBinding*>(binding);
+        CommandBuffer& cmds = m_cmdBufs[m_fillBuf];
+        if (cbind->m_recordSerial != m_frameSerial)
+        {
+            cbind->m_recordSerial = m_frameSerial;
+            cmds.m_resTokens.push_back(cbind->lock());
+        }
+        CmdBinding cmd = {cbind, uint8_t(std::min(dynOffsetCount, size_t(BOO_GLSL_MAX_UNIFORM_COUNT)))};
+        cmds.push(Op::SetShaderDataBinding, cmd);
+        for (size_t i=0 ; i<cmd.dynOffCount ; ++i)
+        {
+            uint32_t off = uint32_t(dynOffsets[i]);
+            memcpy(cmds._append(sizeof(off)), &off, sizeof(off));
+        }
     }
 
     void setRenderTarget(ITextureR* target)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::SetRenderTarget);
-        cmds.back().target = target;
+        m_cmdBufs[m_fillBuf].push(Op::SetRenderTarget, static_cast<const GLTextureR*>(target));
     }
 
     void setViewport(const SWindowRect& rect, float znear, float zfar)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::SetViewport);
-        cmds.back().viewport.rect = rect;
-        cmds.back().viewport.znear = znear;
-        cmds.back().viewport.zfar = zfar;
+        m_cmdBufs[m_fillBuf].push(Op::SetViewport, CmdViewport{rect, znear, zfar});
     }
 
     void setScissor(const SWindowRect& rect)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::SetScissor);
-        cmds.back().viewport.rect = rect;
+        m_cmdBufs[m_fillBuf].push(Op::SetScissor, rect);
     }
 
     void resizeRenderTexture(ITextureR* tex, size_t width, size_t height)
@@ -1285,69 +2394,82 @@ struct GLCommandQueue : IGraphicsCommandQueue
 
     void setClearColor(const float rgba[4])
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::SetClearColor);
-        cmds.back().rgba[0] = rgba[0];
-        cmds.back().rgba[1] = rgba[1];
-        cmds.back().rgba[2] = rgba[2];
-        cmds.back().rgba[3] = rgba[3];
+        m_cmdBufs[m_fillBuf].push(Op::SetClearColor, std::array<float, 4>{{rgba[0], rgba[1], rgba[2], rgba[3]}});
     }
 
     void clearTarget(bool render=true, bool depth=true)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::ClearTarget);
-        cmds.back().flags = 0;
+        GLbitfield flags = 0;
         if (render)
-            cmds.back().flags |= GL_COLOR_BUFFER_BIT;
+            flags |= GL_COLOR_BUFFER_BIT;
         if (depth)
-            cmds.back().flags |= GL_DEPTH_BUFFER_BIT;
+            flags |= GL_DEPTH_BUFFER_BIT;
+        m_cmdBufs[m_fillBuf].push(Op::ClearTarget, flags);
     }
 
     void draw(size_t start, size_t count)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::Draw);
-        cmds.back().start = start;
-        cmds.back().count = count;
+        m_cmdBufs[m_fillBuf].push(Op::Draw, CmdDraw{uint32_t(start), uint32_t(count)});
     }
 
     void drawIndexed(size_t start, size_t count)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::DrawIndexed);
-        cmds.back().start = start;
-        cmds.back().count = count;
+        m_cmdBufs[m_fillBuf].push(Op::DrawIndexed, CmdDraw{uint32_t(start), uint32_t(count)});
     }
 
     void drawInstances(size_t start, size_t count, size_t instCount)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::DrawInstances);
-        cmds.back().start = start;
-        cmds.back().count = count;
-        cmds.back().instCount = instCount;
+        m_cmdBufs[m_fillBuf].push(Op::DrawInstances,
+                                  CmdDrawInstances{uint32_t(start), uint32_t(count), uint32_t(instCount)});
     }
 
     void drawInstancesIndexed(size_t start, size_t count, size_t instCount)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::DrawInstancesIndexed);
-        cmds.back().start = start;
-        cmds.back().count = count;
-        cmds.back().instCount = instCount;
+        m_cmdBufs[m_fillBuf].push(Op::DrawInstancesIndexed,
+                                  CmdDrawInstances{uint32_t(start), uint32_t(count), uint32_t(instCount)});
+    }
+
+    /* Emulated through buffer readback where the context lacks the extensions */
+    bool supportsDrawIndirect() const {return true;}
+    bool supportsDrawIndirectCount() const {return true;}
+
+    void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        m_cmdBufs[m_fillBuf].push(Op::DrawIndirect,
+                                  CmdDrawIndirect{indirectBuf, uint32_t(offset), uint32_t(drawCount), nullptr, 0});
+    }
+
+    void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        m_cmdBufs[m_fillBuf].push(Op::DrawIndexedIndirect,
+                                  CmdDrawIndirect{indirectBuf, uint32_t(offset), uint32_t(drawCount), nullptr, 0});
+    }
+
+    void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                           IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        m_cmdBufs[m_fillBuf].push(Op::DrawIndirect,
+                                  CmdDrawIndirect{indirectBuf, uint32_t(offset), uint32_t(maxDrawCount),
+                                                  countBuf, uint32_t(countOffset)});
+    }
+
+    void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                  IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        m_cmdBufs[m_fillBuf].push(Op::DrawIndexedIndirect,
+                                  CmdDrawIndirect{indirectBuf, uint32_t(offset), uint32_t(maxDrawCount),
+                                                  countBuf, uint32_t(countOffset)});
     }
 
     void resolveBindTexture(ITextureR* texture, const SWindowRect& rect, bool tlOrigin, bool color, bool depth)
     {
         GLTextureR* tex = static_cast<GLTextureR*>(texture);
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::ResolveBindTexture);
-        cmds.back().resolveTex = texture;
-        cmds.back().resolveColor = color;
-        cmds.back().resolveDepth = depth;
+        CmdResolve cmd;
+        cmd.tex = tex;
+        cmd.color = color;
+        cmd.depth = depth;
         SWindowRect intersectRect = rect.intersect(SWindowRect(0, 0, tex->m_width, tex->m_height));
-        SWindowRect& targetRect = cmds.back().viewport.rect;
+        SWindowRect& targetRect = cmd.rect;
         targetRect.location[0] = intersectRect.location[0];
         if (tlOrigin)
             targetRect.location[1] = tex->m_height - intersectRect.location[1] - intersectRect.size[1];
@@ -1355,13 +2477,12 @@ struct GLCommandQueue : IGraphicsCommandQueue
             targetRect.location[1] = intersectRect.location[1];
         targetRect.size[0] = intersectRect.size[0];
         targetRect.size[1] = intersectRect.size[1];
+        m_cmdBufs[m_fillBuf].push(Op::ResolveBindTexture, cmd);
     }
 
     void resolveDisplay(ITextureR* source)
     {
-        std::vector<Command>& cmds = m_cmdBufs[m_fillBuf];
-        cmds.emplace_back(Command::Op::Present);
-        cmds.back().source = source;
+        m_cmdBufs[m_fillBuf].push(Op::Present, static_cast<const GLTextureR*>(source));
     }
 
     void addVertexFormat(GLVertexFormat* fmt)
@@ -1399,7 +2520,17 @@ struct GLCommandQueue : IGraphicsCommandQueue
 
     void execute()
     {
+        BOO_TRACE_ZONE("GL execute");
         std::unique_lock<std::mutex> lk(m_mt);
+        /* Ring use implies this thread went through _transientBuffer() */
+        if (m_transientRing.used() && !m_transientBuf->persistent())
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_transientBuf->m_bufs[m_fillBuf]);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, m_transientRing.used(), m_transientBuf->m_cpuBuf.get());
+        }
+        m_transientRing.reset();
+        m_transientFenced = false;
+
         m_completeBuf = m_fillBuf;
         for (size_t i=0 ; i<3 ; ++i)
         {
@@ -1409,22 +2540,14 @@ struct GLCommandQueue : IGraphicsCommandQueue
             break;
         }
 
-        /* Update dynamic data here */
+        /* Update dynamic data here (only resources loaded since all 3 copies were current) */
         GLDataFactoryImpl* gfxF = static_cast<GLDataFactoryImpl*>(m_parent->getDataFactory());
-        std::unique_lock<std::mutex> datalk(gfxF->m_committedMutex);
-        for (GLData* d : gfxF->m_committedData)
-        {
-            for (std::unique_ptr<GLGraphicsBufferD>& b : d->m_DBufs)
-                b->update(m_completeBuf);
-            for (std::unique_ptr<GLTextureD>& t : d->m_DTexs)
-                t->update(m_completeBuf);
-        }
-        for (GLPool* p : gfxF->m_committedPools)
+        gfxF->m_dirtyResources.update(m_completeBuf, 0x7);
+        if (m_texUploadHead)
         {
-            for (auto& b : p->m_DBufs)
-                b.second->update(m_completeBuf);
+            m_texUploadFences[m_completeBuf] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_texUploadHead = 0;
         }
-        datalk.unlock();
         glFlush();
 
         for (auto& p : m_pendingPosts1)
@@ -1434,73 +2557,150 @@ struct GLCommandQueue : IGraphicsCommandQueue
         lk.unlock();
         m_cv.notify_one();
         m_cmdBufs[m_fillBuf].clear();
+        ++m_frameSerial;
     }
 };
 
+/* Record that [0, sz) changed in copy `slot` (or the shadow when slot < 0) */
+void GLGraphicsBufferD::_markWritten(int slot, size_t sz)
+{
+    for (int i=0 ; i<3 ; ++i)
+    {
+        if (i == slot)
+            continue;
+        m_dirtyLo[i] = 0;
+        m_dirtyHi[i] = std::max(m_dirtyHi[i], sz);
+    }
+    if (slot >= 0)
+    {
+        m_latest = slot;
+        m_validSlots.store(1 << slot);
+        queueDirty();
+    }
+    else
+        markDirty();
+}
+
+/* Bring persistent copy `slot` up to date from the newest copy, except for
+ * [0, skipHi) which the caller is about to overwrite */
+void GLGraphicsBufferD::_refreshSlot(int slot, size_t skipHi)
+{
+    size_t lo = std::max(m_dirtyLo[slot], skipHi);
+    size_t hi = m_dirtyHi[slot];
+    if (slot != m_latest && lo < hi)
+        memcpy(m_mapped[slot] + lo, m_mapped[m_latest] + lo, hi - lo);
+    m_dirtyLo[slot] = m_dirtyHi[slot] = 0;
+}
+
 void GLGraphicsBufferD::update(int b)
 {
     int slot = 1 << b;
-    if ((slot & m_validMask) == 0)
+    if ((slot & m_validSlots) == 0)
     {
-        glBindBuffer(m_target, m_bufs[b]);
-        glBufferSubData(m_target, 0, m_cpuSz, m_cpuBuf.get());
-        m_validMask |= slot;
+        if (m_dirtyLo[b] < m_dirtyHi[b])
+        {
+            if (persistent())
+            {
+                m_q->waitSlotFence(b);
+                _refreshSlot(b, 0);
+            }
+            else
+            {
+                glBindBuffer(m_target, m_bufs[b]);
+                glBufferSubData(m_target, m_dirtyLo[b], m_dirtyHi[b] - m_dirtyLo[b],
+                                m_cpuBuf.get() + m_dirtyLo[b]);
+                m_dirtyLo[b] = m_dirtyHi[b] = 0;
+            }
+        }
+        m_validSlots |= slot;
     }
 }
 
 void GLGraphicsBufferD::load(const void* data, size_t sz)
 {
     size_t bufSz = std::min(sz, m_cpuSz);
-    memcpy(m_cpuBuf.get(), data, bufSz);
-    m_validMask = 0;
+    if (persistent())
+    {
+        int fill = m_q->fillSlot();
+        m_q->waitSlotFence(fill);
+        _refreshSlot(fill, bufSz);
+        memcpy(m_mapped[fill], data, bufSz);
+        _markWritten(fill, bufSz);
+    }
+    else
+    {
+        memcpy(m_cpuBuf.get(), data, bufSz);
+        _markWritten(-1, bufSz);
+    }
 }
 void* GLGraphicsBufferD::map(size_t sz)
 {
-    if (sz < m_cpuSz)
+    if (sz > m_cpuSz)
         return nullptr;
+    m_mapSz = sz;
+    if (persistent())
+    {
+        /* Previous contents are preserved, as with the shadow path */
+        m_mapSlot = m_q->fillSlot();
+        m_q->waitSlotFence(m_mapSlot);
+        _refreshSlot(m_mapSlot, 0);
+        return m_mapped[m_mapSlot];
+    }
     return m_cpuBuf.get();
 }
 void GLGraphicsBufferD::unmap()
 {
-    m_validMask = 0;
+    _markWritten(persistent() ? m_mapSlot : -1, m_mapSz);
 }
 void GLGraphicsBufferD::bindVertex(int b)
 {glBindBuffer(GL_ARRAY_BUFFER, m_bufs[b]);}
 void GLGraphicsBufferD::bindIndex(int b)
 {glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufs[b]);}
-void GLGraphicsBufferD::bindUniform(size_t idx, int b)
-{glBindBufferBase(GL_UNIFORM_BUFFER, idx, m_bufs[b]);}
-void GLGraphicsBufferD::bindUniformRange(size_t idx, GLintptr off, GLsizeiptr size, int b)
-{glBindBufferRange(GL_UNIFORM_BUFFER, idx, m_bufs[b], off, size);}
+void GLGraphicsBufferD::bindUniform(GLStateCache& st, size_t idx, int b)
+{st.bindUniformBase(idx, m_bufs[b]);}
+void GLGraphicsBufferD::bindUniformRange(GLStateCache& st, size_t idx, GLintptr off, GLsizeiptr size, int b)
+{st.bindUniformRange(idx, m_bufs[b], off, size);}
+
+IGraphicsBufferD* GLDataFactoryImpl::newPoolBuffer(IGraphicsBufferPool* p, BufferUse use,
+                                                   size_t stride, size_t count)
+{
+    GLPool* pool = static_cast<GLPool*>(p);
+    GLCommandQueue* q = static_cast<GLCommandQueue*>(m_parent->getCommandQueue());
+    GLGraphicsBufferD* retval = new GLGraphicsBufferD(q, use, stride * count);
+    retval->attachDirtyList(m_dirtyResources);
+    pool->m_DBufs.emplace(std::make_pair(retval, std::unique_ptr<GLGraphicsBufferD>(retval)));
+    return retval;
+}
 
 IGraphicsBufferD*
 GLDataFactory::Context::newDynamicBuffer(BufferUse use, size_t stride, size_t count)
 {
-    GLGraphicsBufferD* retval = new GLGraphicsBufferD(use, stride * count);
+    GLDataFactoryImpl& factory = static_cast<GLDataFactoryImpl&>(m_parent);
+    GLCommandQueue* q = static_cast<GLCommandQueue*>(factory.m_parent->getCommandQueue());
+    GLGraphicsBufferD* retval = new GLGraphicsBufferD(q, use, stride * count);
     GLDataFactoryImpl::m_deferredData->m_DBufs.emplace_back(retval);
     return retval;
 }
 
-GLTextureD::GLTextureD(size_t width, size_t height, TextureFormat fmt)
-: m_width(width), m_height(height)
+GLTextureD::GLTextureD(GLCommandQueue* q, size_t width, size_t height, TextureFormat fmt)
+: m_q(q), m_width(width), m_height(height)
 {
-    int pxPitch = 4;
     switch (fmt)
     {
     case TextureFormat::RGBA8:
         m_intFormat = GL_RGBA8;
         m_format = GL_RGBA;
-        pxPitch = 4;
+        m_pxPitch = 4;
         break;
     case TextureFormat::I8:
         m_intFormat = GL_R8;
         m_format = GL_RED;
-        pxPitch = 1;
+        m_pxPitch = 1;
         break;
     default:
         Log.report(logvisor::Fatal, "unsupported tex format");
     }
-    m_cpuSz = width * height * pxPitch;
+    m_cpuSz = width * height * m_pxPitch;
     m_cpuBuf.reset(new uint8_t[m_cpuSz]);
 
     glGenTextures(3, m_texs);
@@ -1512,16 +2712,27 @@ GLTextureD::GLTextureD(size_t width, size_t height, TextureFormat fmt)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     }
 }
-GLTextureD::~GLTextureD() {glDeleteTextures(3, m_texs);}
+GLTextureD::~GLTextureD() {detachDirtyList(); glDeleteTextures(3, m_texs);}
+
+void GLTextureD::_markRegion(size_t x, size_t y, size_t w, size_t h)
+{
+    for (int i=0 ; i<3 ; ++i)
+        m_dirty[i].merge(x, y, w, h);
+    markDirty();
+}
 
 void GLTextureD::update(int b)
 {
     int slot = 1 << b;
-    if ((slot & m_validMask) == 0)
+    if ((slot & m_validSlots) == 0)
     {
-        glBindTexture(GL_TEXTURE_2D, m_texs[b]);
-        glTexImage2D(GL_TEXTURE_2D, 0, m_intFormat, m_width, m_height, 0, m_format, GL_UNSIGNED_BYTE, m_cpuBuf.get());
-        m_validMask |= slot;
+        if (!m_dirty[b].empty())
+        {
+            glBindTexture(GL_TEXTURE_2D, m_texs[b]);
+            m_q->_uploadTexRegion(m_format, m_pxPitch, m_width, m_cpuBuf.get(), m_dirty[b]);
+            m_dirty[b].clear();
+        }
+        m_validSlots |= slot;
     }
 }
 
@@ -1529,7 +2740,7 @@ void GLTextureD::load(const void* data, size_t sz)
 {
     size_t bufSz = std::min(sz, m_cpuSz);
     memcpy(m_cpuBuf.get(), data, bufSz);
-    m_validMask = 0;
+    _markRegion(0, 0, m_width, m_height);
 }
 void* GLTextureD::map(size_t sz)
 {
@@ -1539,19 +2750,25 @@ void* GLTextureD::map(size_t sz)
 }
 void GLTextureD::unmap()
 {
-    m_validMask = 0;
+    _markRegion(0, 0, m_width, m_height);
+}
+void GLTextureD::loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)
+{
+    if (CopyTextureRegion(m_cpuBuf.get(), m_width, m_height, m_pxPitch, x, y, w, h, data, pitch))
+        _markRegion(x, y, w, h);
 }
 
-void GLTextureD::bind(size_t idx, int b)
+void GLTextureD::bind(GLStateCache& st, size_t idx, int b)
 {
-    glActiveTexture(GL_TEXTURE0 + idx);
-    glBindTexture(GL_TEXTURE_2D, m_texs[b]);
+    st.bindTexture(idx, GL_TEXTURE_2D, m_texs[b]);
 }
 
 ITextureD*
 GLDataFactory::Context::newDynamicTexture(size_t width, size_t height, TextureFormat fmt)
 {
-    GLTextureD* retval = new GLTextureD(width, height, fmt);
+    GLDataFactoryImpl& factory = static_cast<GLDataFactoryImpl&>(m_parent);
+    GLCommandQueue* q = static_cast<GLCommandQueue*>(factory.m_parent->getCommandQueue());
+    GLTextureD* retval = new GLTextureD(q, width, height, fmt);
     GLDataFactoryImpl::m_deferredData->m_DTexs.emplace_back(retval);
     return retval;
 }
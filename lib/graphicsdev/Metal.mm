@@ -283,6 +283,7 @@ public:
     void load(const void* data, size_t sz);
     void* map(size_t sz);
     void unmap();
+    void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch);
 };
 
 class MetalTextureR : public ITextureR
@@ -911,6 +912,28 @@ struct MetalCommandQueue : IGraphicsCommandQueue
                        instanceCount:instCount];
     }
 
+    void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirect unsupported on Metal");
+    }
+
+    void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirect unsupported on Metal");
+    }
+
+    void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                           IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndirectCount unsupported on Metal");
+    }
+
+    void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                  IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+        Log.report(logvisor::Error, "drawIndexedIndirectCount unsupported on Metal");
+    }
+
     void resolveBindTexture(ITextureR* texture, const SWindowRect& rect, bool tlOrigin, bool color, bool depth)
     {
         MetalTextureR* tex = static_cast<MetalTextureR*>(texture);
@@ -1101,6 +1124,11 @@ void MetalTextureD::unmap()
 {
     m_validSlots = 0;
 }
+void MetalTextureD::loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)
+{
+    if (CopyTextureRegion(m_cpuBuf.get(), m_width, m_height, m_pxPitch, x, y, w, h, data, pitch))
+        m_validSlots = 0;
+}
 
 MetalDataFactoryImpl::MetalDataFactoryImpl(IGraphicsContext* parent, MetalContext* ctx, uint32_t sampleCount)
 : m_parent(parent), m_ctx(ctx), m_sampleCount(sampleCount) {}
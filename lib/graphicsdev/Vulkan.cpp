@@ -1,5 +1,7 @@
 #include "boo/graphicsdev/Vulkan.hpp"
 #include "boo/IGraphicsContext.hpp"
+#include "boo/Trace.hpp"
+#include "boo/TaskScheduler.hpp"
 #include <vector>
 #include <array>
 #include <cmath>
@@ -33,6 +35,17 @@ struct VulkanShareableShader : IShareableShader<VulkanDataFactoryImpl, VulkanSha
     ~VulkanShareableShader() { vk::DestroyShaderModule(m_dev, m_shader, nullptr); }
 };
 
+/* Pipelines shared by every newShaderPipeline call with the same binaries,
+ * vertex layout and fixed-function state */
+struct VulkanShareablePipeline;
+struct VulkanPipelineRegistry
+{
+    std::recursive_mutex& m_lock;
+    std::unordered_map<uint64_t, std::unique_ptr<VulkanShareablePipeline>> m_pipelines;
+    VulkanPipelineRegistry(std::recursive_mutex& lock) : m_lock(lock) {}
+    void _unregisterShareableShader(uint64_t srcKey, uint64_t binKey);
+};
+
 class VulkanDataFactoryImpl : public VulkanDataFactory
 {
     friend struct VulkanCommandQueue;
@@ -44,9 +57,18 @@ class VulkanDataFactoryImpl : public VulkanDataFactory
     std::unordered_set<struct VulkanData*> m_committedData;
     std::unordered_set<struct VulkanPool*> m_committedPools;
     std::mutex m_committedMutex;
+    DirtyResourceList m_dirtyResources;
+
+    /* Loader threads may build pipelines concurrently; guards the shader and
+     * pipeline registries and m_sourceToBinary (recursive, since releasing a
+     * pipeline releases its shaders) */
+    std::recursive_mutex m_sharedLock;
     std::unordered_map<uint64_t, std::unique_ptr<VulkanShareableShader>> m_sharedShaders;
+    VulkanPipelineRegistry m_sharedPipelines = {m_sharedLock};
     std::vector<int> m_texUnis;
     void destroyData(IGraphicsData*);
+    bool isDataReady(IGraphicsData*);
+    void waitData(IGraphicsData*);
     void destroyPool(IGraphicsBufferPool*);
     void destroyAllData();
     IGraphicsBufferD* newPoolBuffer(IGraphicsBufferPool *pool, BufferUse use,
@@ -65,9 +87,13 @@ public:
 
     void _unregisterShareableShader(uint64_t srcKey, uint64_t binKey)
     {
+        std::unique_lock<std::recursive_mutex> lk(m_sharedLock);
+        auto search = m_sharedShaders.find(binKey);
+        if (search == m_sharedShaders.end() || !search->second->expired())
+            return;
         if (srcKey)
             m_sourceToBinary.erase(srcKey);
-        m_sharedShaders.erase(binKey);
+        m_sharedShaders.erase(search);
     }
 };
 
@@ -151,26 +177,37 @@ static void SetImageLayout(VkCommandBuffer cmd, VkImage image,
     imageMemoryBarrier.subresourceRange.levelCount = mipCount;
     imageMemoryBarrier.subresourceRange.layerCount = layerCount;
 
+    /* Stages must cover the accesses; load submissions aren't waited on, so
+     * draws in later submissions rely on these to see uploaded texels */
+    VkPipelineStageFlags src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkPipelineStageFlags dest_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
     switch (old_image_layout)
     {
     case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
         imageMemoryBarrier.srcAccessMask =
             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+        src_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         break;
     case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
         imageMemoryBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        src_stages = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
         break;
     case VK_IMAGE_LAYOUT_PREINITIALIZED:
         imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+        src_stages = VK_PIPELINE_STAGE_HOST_BIT;
         break;
     case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
         imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        src_stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
         break;
     case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
         imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        src_stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
         break;
     case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
         imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        src_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         break;
     default: break;
     }
@@ -179,30 +216,34 @@ static void SetImageLayout(VkCommandBuffer cmd, VkImage image,
     {
     case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
         imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        dest_stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
         break;
     case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
         imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        dest_stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
         break;
     case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        /* Textures may be sampled from vertex shaders too */
         imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        dest_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         break;
     case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
         imageMemoryBarrier.dstAccessMask =
             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+        dest_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         break;
     case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
         imageMemoryBarrier.dstAccessMask =
             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dest_stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         break;
     case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
         imageMemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        dest_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
         break;
     default: break;
     }
 
-    VkPipelineStageFlags src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    VkPipelineStageFlags dest_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-
     vk::CmdPipelineBarrier(cmd, src_stages, dest_stages, 0, 0, NULL, 0, NULL,
                            1, &imageMemoryBarrier);
 }
@@ -444,14 +485,91 @@ void VulkanContext::initDevice()
     deviceInfo.enabledLayerCount = m_layerNames.size();
     deviceInfo.ppEnabledLayerNames =
         deviceInfo.enabledLayerCount ? m_layerNames.data() : nullptr;
+
+#ifdef VK_KHR_draw_indirect_count
+    /* GPU-sourced draw counts for drawIndirectCount() */
+    uint32_t extCount = 0;
+    ThrowIfFailed(vk::EnumerateDeviceExtensionProperties(m_gpus[0], nullptr, &extCount, nullptr));
+    std::vector<VkExtensionProperties> exts(extCount);
+    ThrowIfFailed(vk::EnumerateDeviceExtensionProperties(m_gpus[0], nullptr, &extCount, exts.data()));
+    for (const VkExtensionProperties& ext : exts)
+    {
+        if (!strcmp(ext.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+        {
+            m_deviceExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            m_drawIndirectCount = true;
+            break;
+        }
+    }
+#endif
+
     deviceInfo.enabledExtensionCount = m_deviceExtensionNames.size();
     deviceInfo.ppEnabledExtensionNames =
         deviceInfo.enabledExtensionCount ? m_deviceExtensionNames.data() : nullptr;
-    deviceInfo.pEnabledFeatures = nullptr;
+
+    /* Optional features used by indirect draws when present */
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vk::GetPhysicalDeviceFeatures(m_gpus[0], &supportedFeatures);
+    m_enabledFeatures = {};
+    m_enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    m_enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    deviceInfo.pEnabledFeatures = &m_enabledFeatures;
 
     ThrowIfFailed(vk::CreateDevice(m_gpus[0], &deviceInfo, nullptr, &m_dev));
 }
 
+void VulkanContext::LoadContext::beginCmdBuf(VkDevice dev)
+{
+    std::unique_lock<std::mutex> lk(m_retireLock);
+    if (m_freeCmdBufs.size())
+    {
+        m_cmdBuf = m_freeCmdBufs.back();
+        m_freeCmdBufs.pop_back();
+        lk.unlock();
+        ThrowIfFailed(vk::ResetCommandBuffer(m_cmdBuf, 0));
+    }
+    else
+    {
+        lk.unlock();
+        VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = nullptr;
+        cmd.commandPool = m_pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd.commandBufferCount = 1;
+        ThrowIfFailed(vk::AllocateCommandBuffers(dev, &cmd, &m_cmdBuf));
+    }
+
+    VkCommandBufferBeginInfo cmdBufBeginInfo = {};
+    cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBufBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    ThrowIfFailed(vk::BeginCommandBuffer(m_cmdBuf, &cmdBufBeginInfo));
+}
+
+VulkanContext::LoadContext& VulkanContext::getLoadContext()
+{
+    if (LoadContext* ctx = m_threadLoadCtx.get())
+        return *ctx;
+
+    std::unique_ptr<LoadContext> ctx(new LoadContext);
+
+    VkCommandPoolCreateInfo cmdPoolInfo = {};
+    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmdPoolInfo.pNext = nullptr;
+    cmdPoolInfo.queueFamilyIndex = m_graphicsQueueFamilyIndex;
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    ThrowIfFailed(vk::CreateCommandPool(m_dev, &cmdPoolInfo, nullptr, &ctx->m_pool));
+
+    /* Begin load command buffer here */
+    ctx->beginCmdBuf(m_dev);
+
+    LoadContext* ret = ctx.get();
+    m_threadLoadCtx.reset(ret);
+    std::unique_lock<std::mutex> lk(m_loadCtxLock);
+    m_loadCtxs.push_back(std::move(ctx));
+    return *ret;
+}
+
 void VulkanContext::initSwapChain(VulkanContext::Window& windowCtx, VkSurfaceKHR surface, VkFormat format, VkColorSpaceKHR colorspace)
 {
     m_displayFormat = format;
@@ -545,34 +663,8 @@ void VulkanContext::initSwapChain(VulkanContext::Window& windowCtx, VkSurfaceKHR
     std::unique_ptr<VkImage[]> swapchainImages(new VkImage[swapchainImageCount]);
     ThrowIfFailed(vk::GetSwapchainImagesKHR(m_dev, sc.m_swapChain, &swapchainImageCount, swapchainImages.get()));
 
-    // Going to need a command buffer to send the memory barriers in
-    // set_image_layout but we couldn't have created one before we knew
-    // what our graphics_queue_family_index is, but now that we have it,
-    // create the command buffer
-
-    VkCommandPoolCreateInfo cmdPoolInfo = {};
-    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmdPoolInfo.pNext = nullptr;
-    cmdPoolInfo.queueFamilyIndex = m_graphicsQueueFamilyIndex;
-    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    ThrowIfFailed(vk::CreateCommandPool(m_dev, &cmdPoolInfo, nullptr, &m_loadPool));
-
-    VkCommandBufferAllocateInfo cmd = {};
-    cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmd.pNext = nullptr;
-    cmd.commandPool = m_loadPool;
-    cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmd.commandBufferCount = 1;
-    ThrowIfFailed(vk::AllocateCommandBuffers(m_dev, &cmd, &m_loadCmdBuf));
-
     vk::GetDeviceQueue(m_dev, m_graphicsQueueFamilyIndex, 0, &m_queue);
 
-    /* Begin load command buffer here */
-    VkCommandBufferBeginInfo cmdBufBeginInfo = {};
-    cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    cmdBufBeginInfo.flags = 0;
-    ThrowIfFailed(vk::BeginCommandBuffer(m_loadCmdBuf, &cmdBufBeginInfo));
-
     /* Create shared linear sampler */
     VkSamplerCreateInfo samplerInfo = {};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -735,9 +827,23 @@ struct VulkanData : IGraphicsDataPriv<VulkanData>
     std::vector<std::unique_ptr<class VulkanTextureR>> m_RTexs;
     std::vector<std::unique_ptr<struct VulkanVertexFormat>> m_VFmts;
     bool m_dead = false;
+
+    /* Signaled when the GPU has consumed this data's static texture uploads;
+     * staging objects are released by whichever thread first observes it */
+    VkFence m_uploadFence = VK_NULL_HANDLE;
+    std::atomic_bool m_uploadPending = {false};
+    bool uploadReady();
+    void waitUpload();
+    void retireUploads();
+
     VulkanData(VulkanContext* ctx) : m_ctx(ctx) {}
     ~VulkanData()
     {
+        if (m_uploadFence)
+        {
+            waitUpload();
+            vk::DestroyFence(m_ctx->m_dev, m_uploadFence, nullptr);
+        }
         if (m_bufMem)
             vk::FreeMemory(m_ctx->m_dev, m_bufMem, nullptr);
         if (m_texMem)
@@ -787,7 +893,8 @@ static const VkBufferUsageFlagBits USE_TABLE[] =
     VkBufferUsageFlagBits(0),
     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
     VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
 };
 
 class VulkanGraphicsBufferS : public IGraphicsBufferS
@@ -856,7 +963,7 @@ public:
     }
 };
 
-class VulkanGraphicsBufferD : public IGraphicsBufferD
+class VulkanGraphicsBufferD : public IGraphicsBufferD, public IDynamicResourcePriv
 {
     friend class VulkanDataFactory;
     friend class VulkanDataFactoryImpl;
@@ -864,7 +971,6 @@ class VulkanGraphicsBufferD : public IGraphicsBufferD
     struct VulkanCommandQueue* m_q;
     size_t m_cpuSz;
     std::unique_ptr<uint8_t[]> m_cpuBuf;
-    int m_validSlots = 0;
     VulkanGraphicsBufferD(VulkanCommandQueue* q, BufferUse use, VulkanContext* ctx, size_t stride, size_t count)
     : m_q(q), m_stride(stride), m_count(count), m_cpuSz(stride * count), m_cpuBuf(new uint8_t[m_cpuSz]),
       m_uniform(use == BufferUse::Uniform)
@@ -894,6 +1000,7 @@ public:
     VkDeviceSize m_memOffset[2];
     VkDescriptorBufferInfo m_bufferInfo[2];
     bool m_uniform = false;
+    bool m_transient = false;
     ~VulkanGraphicsBufferD();
     void load(const void* data, size_t sz);
     void* map(size_t sz);
@@ -1079,9 +1186,11 @@ public:
         ThrowIfFailed(vk::CreateImageView(ctx->m_dev, &viewInfo, nullptr, &m_gpuView));
         m_descInfo.imageView = m_gpuView;
 
+        VkCommandBuffer loadCmdBuf = ctx->getLoadContext().m_cmdBuf;
+
         /* Since we're going to blit to the texture image, set its layout to
          * DESTINATION_OPTIMAL */
-        SetImageLayout(ctx->m_loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
+        SetImageLayout(loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
                        VK_IMAGE_LAYOUT_UNDEFINED,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mips, 1);
 
@@ -1111,7 +1220,7 @@ public:
         }
 
         /* Put the copy command into the command buffer */
-        vk::CmdCopyBufferToImage(ctx->m_loadCmdBuf,
+        vk::CmdCopyBufferToImage(loadCmdBuf,
                                  m_cpuBuf,
                                  m_gpuTex,
                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -1120,7 +1229,7 @@ public:
 
         /* Set the layout for the texture image from DESTINATION_OPTIMAL to
          * SHADER_READ_ONLY */
-        SetImageLayout(ctx->m_loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
+        SetImageLayout(loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_mips, 1);
     }
@@ -1272,9 +1381,11 @@ public:
         ThrowIfFailed(vk::CreateImageView(ctx->m_dev, &viewInfo, nullptr, &m_gpuView));
         m_descInfo.imageView = m_gpuView;
 
+        VkCommandBuffer loadCmdBuf = ctx->getLoadContext().m_cmdBuf;
+
         /* Since we're going to blit to the texture image, set its layout to
          * DESTINATION_OPTIMAL */
-        SetImageLayout(ctx->m_loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
+        SetImageLayout(loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
                        VK_IMAGE_LAYOUT_UNDEFINED,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mips, m_layers);
 
@@ -1304,7 +1415,7 @@ public:
         }
 
         /* Put the copy command into the command buffer */
-        vk::CmdCopyBufferToImage(ctx->m_loadCmdBuf,
+        vk::CmdCopyBufferToImage(loadCmdBuf,
                                  m_cpuBuf,
                                  m_gpuTex,
                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -1313,7 +1424,7 @@ public:
 
         /* Set the layout for the texture image from DESTINATION_OPTIMAL to
          * SHADER_READ_ONLY */
-        SetImageLayout(ctx->m_loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
+        SetImageLayout(loadCmdBuf, m_gpuTex, VK_IMAGE_ASPECT_COLOR_BIT,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_mips, m_layers);
     }
@@ -1322,7 +1433,7 @@ public:
     size_t layers() const {return m_layers;}
 };
 
-class VulkanTextureD : public ITextureD
+class VulkanTextureD : public ITextureD, public IDynamicResourcePriv
 {
     friend class VulkanDataFactory;
     friend struct VulkanCommandQueue;
@@ -1333,9 +1444,15 @@ class VulkanTextureD : public ITextureD
     std::unique_ptr<uint8_t[]> m_stagingBuf;
     size_t m_cpuSz;
     VkDeviceSize m_srcRowPitch;
+    size_t m_pxPitch;
     VkDeviceSize m_cpuOffsets[2];
     VkFormat m_vkFmt;
-    int m_validSlots = 0;
+
+    /* Region each image lacks relative to m_stagingBuf; an image that has never
+     * been written is uploaded whole, since its first transition discards contents */
+    TextureDirtyRect m_dirty[2];
+    bool m_gpuInit[2] = {};
+
     VulkanTextureD(VulkanCommandQueue* q, VulkanContext* ctx, size_t width, size_t height, TextureFormat fmt)
     : m_width(width), m_height(height), m_fmt(fmt), m_q(q)
     {
@@ -1344,11 +1461,13 @@ class VulkanTextureD : public ITextureD
         {
         case TextureFormat::RGBA8:
             pfmt = VK_FORMAT_R8G8B8A8_UNORM;
+            m_pxPitch = 4;
             m_srcRowPitch = width * 4;
             m_cpuSz = m_srcRowPitch * height;
             break;
         case TextureFormat::I8:
             pfmt = VK_FORMAT_R8_UNORM;
+            m_pxPitch = 1;
             m_srcRowPitch = width;
             m_cpuSz = m_srcRowPitch * height;
             break;
@@ -1424,6 +1543,7 @@ class VulkanTextureD : public ITextureD
             m_descInfo[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         }
     }
+    void _markRegion(size_t x, size_t y, size_t w, size_t h);
     void update(int b);
 public:
     VkBuffer m_cpuBuf[2];
@@ -1437,6 +1557,7 @@ public:
     void load(const void* data, size_t sz);
     void* map(size_t sz);
     void unmap();
+    void loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch);
 
     VkDeviceSize sizeForGPU(VulkanContext* ctx, uint32_t& memTypeBits, VkDeviceSize offset)
     {
@@ -1826,23 +1947,22 @@ static const VkBlendFactor BLEND_FACTOR_TABLE[] =
     VK_BLEND_FACTOR_ONE_MINUS_SRC1_COLOR
 };
 
-class VulkanShaderPipeline : public IShaderPipeline
+struct VulkanShareablePipeline : IShareableShader<VulkanPipelineRegistry, VulkanShareablePipeline>
 {
-    friend class VulkanDataFactory;
-    friend struct VulkanShaderDataBinding;
     VulkanContext* m_ctx;
     VkPipelineCache m_pipelineCache;
-    const VulkanVertexFormat* m_vtxFmt;
     VulkanShareableShader::Token m_vert;
     VulkanShareableShader::Token m_frag;
-    VulkanShaderPipeline(VulkanContext* ctx,
-                         VulkanShareableShader::Token&& vert,
-                         VulkanShareableShader::Token&& frag,
-                         VkPipelineCache pipelineCache,
-                         const VulkanVertexFormat* vtxFmt,
-                         BlendFactor srcFac, BlendFactor dstFac, Primitive prim,
-                         bool depthTest, bool depthWrite, CullMode culling)
-    : m_ctx(ctx), m_pipelineCache(pipelineCache), m_vtxFmt(vtxFmt),
+    VkPipeline m_pipeline;
+    VulkanShareablePipeline(VulkanPipelineRegistry& reg, uint64_t key,
+                            VulkanContext* ctx,
+                            VulkanShareableShader::Token&& vert,
+                            VulkanShareableShader::Token&& frag,
+                            VkPipelineCache pipelineCache,
+                            const VulkanVertexFormat* vtxFmt,
+                            BlendFactor srcFac, BlendFactor dstFac, Primitive prim,
+                            bool depthTest, bool depthWrite, CullMode culling)
+    : IShareableShader(reg, key, 0), m_ctx(ctx), m_pipelineCache(pipelineCache),
       m_vert(std::move(vert)), m_frag(std::move(frag))
     {
         VkCullModeFlagBits cullMode;
@@ -1969,14 +2089,34 @@ class VulkanShaderPipeline : public IShaderPipeline
         ThrowIfFailed(vk::CreateGraphicsPipelines(ctx->m_dev, pipelineCache, 1, &pipelineCreateInfo,
                                                   nullptr, &m_pipeline));
     }
-public:
-    VkPipeline m_pipeline;
-    ~VulkanShaderPipeline()
+    ~VulkanShareablePipeline()
     {
         vk::DestroyPipeline(m_ctx->m_dev, m_pipeline, nullptr);
         if (m_pipelineCache)
             vk::DestroyPipelineCache(m_ctx->m_dev, m_pipelineCache, nullptr);
     }
+    VulkanShareablePipeline& operator=(const VulkanShareablePipeline&) = delete;
+    VulkanShareablePipeline(const VulkanShareablePipeline&) = delete;
+};
+
+void VulkanPipelineRegistry::_unregisterShareableShader(uint64_t srcKey, uint64_t binKey)
+{
+    std::unique_lock<std::recursive_mutex> lk(m_lock);
+    auto search = m_pipelines.find(srcKey);
+    if (search != m_pipelines.end() && search->second->expired())
+        m_pipelines.erase(search);
+}
+
+class VulkanShaderPipeline : public IShaderPipeline
+{
+    friend class VulkanDataFactory;
+    friend struct VulkanShaderDataBinding;
+    VulkanShareablePipeline::Token m_shared;
+    const VulkanVertexFormat* m_vtxFmt;
+    VulkanShaderPipeline(VulkanShareablePipeline::Token&& shared, const VulkanVertexFormat* vtxFmt)
+    : m_shared(std::move(shared)), m_vtxFmt(vtxFmt), m_pipeline(m_shared.get().m_pipeline) {}
+public:
+    VkPipeline m_pipeline;
     VulkanShaderPipeline& operator=(const VulkanShaderPipeline&) = delete;
     VulkanShaderPipeline(const VulkanShaderPipeline&) = delete;
 };
@@ -2120,15 +2260,17 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
 
         if (ubufOffs && ubufSizes)
         {
+            VkDeviceSize align = ctx->m_gpuProps.limits.minUniformBufferOffsetAlignment;
             m_ubufOffs.reserve(ubufCount);
             for (size_t i=0 ; i<ubufCount ; ++i)
             {
 #ifndef NDEBUG
-                if (ubufOffs[i] % 256)
-                    Log.report(logvisor::Fatal, "non-256-byte-aligned uniform-offset %d provided to newShaderDataBinding", int(i));
+                if (ubufOffs[i] % align)
+                    Log.report(logvisor::Fatal, "non-%d-byte-aligned uniform-offset %d provided to newShaderDataBinding",
+                               int(align), int(i));
 #endif
                 std::array<VkDescriptorBufferInfo, 2> fillArr;
-                fillArr.fill({VK_NULL_HANDLE, ubufOffs[i], (ubufSizes[i] + 255) & ~255});
+                fillArr.fill({VK_NULL_HANDLE, ubufOffs[i], (ubufSizes[i] + align - 1) / align * align});
                 m_ubufOffs.push_back(fillArr);
             }
         }
@@ -2154,7 +2296,7 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
             descriptorPoolInfo.poolSizeCount = 2;
             descriptorPoolInfo.pPoolSizes = poolSizes;
 
-            poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             poolSizes[0].descriptorCount = BOO_GLSL_MAX_UNIFORM_COUNT * 2;
 
             poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -2217,7 +2359,7 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
                             writes[totalWrites].pNext = nullptr;
                             writes[totalWrites].dstSet = m_descSets[b];
                             writes[totalWrites].descriptorCount = 1;
-                            writes[totalWrites].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                            writes[totalWrites].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                             const VkDescriptorBufferInfo* origInfo = GetBufferGPUResource(m_ubufs[i], b);
                             modInfo.buffer = origInfo->buffer;
                             modInfo.offset += origInfo->offset;
@@ -2240,7 +2382,7 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
                         writes[totalWrites].pNext = nullptr;
                         writes[totalWrites].dstSet = m_descSets[b];
                         writes[totalWrites].descriptorCount = 1;
-                        writes[totalWrites].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                        writes[totalWrites].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                         writes[totalWrites].pBufferInfo = GetBufferGPUResource(m_ubufs[i], b);
                         writes[totalWrites].dstArrayElement = 0;
                         writes[totalWrites].dstBinding = binding;
@@ -2276,7 +2418,7 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
 #endif
     }
 
-    void bind(VkCommandBuffer cmdBuf, int b)
+    void bind(VkCommandBuffer cmdBuf, int b, const size_t* dynOffs=nullptr, size_t dynOffCount=0)
     {
 #ifndef NDEBUG
         if (!m_committed)
@@ -2313,7 +2455,13 @@ struct VulkanShaderDataBinding : IShaderDataBindingPriv<VulkanData>
             vk::UpdateDescriptorSets(m_ctx->m_dev, totalWrites, writes, 0, nullptr);
 
         vk::CmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->m_pipeline);
-        vk::CmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ctx->m_pipelinelayout, 0, 1, &m_descSets[b], 0, nullptr);
+        /* Every uniform binding is dynamic; only transient-ring slots take a nonzero offset */
+        uint32_t dynamicOffsets[BOO_GLSL_MAX_UNIFORM_COUNT] = {};
+        for (size_t i=0 ; i<m_ubufCount && i<dynOffCount && i<BOO_GLSL_MAX_UNIFORM_COUNT ; ++i)
+            if (m_ubufs[i]->dynamic() && static_cast<VulkanGraphicsBufferD*>(m_ubufs[i])->m_transient)
+                dynamicOffsets[i] = uint32_t(dynOffs[i]);
+        vk::CmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ctx->m_pipelinelayout, 0, 1, &m_descSets[b],
+                                  BOO_GLSL_MAX_UNIFORM_COUNT, dynamicOffsets);
 
         if (m_vbuf && m_instVbuf)
             vk::CmdBindVertexBuffers(cmdBuf, 0, 2, m_vboBufs[b], m_vboOffs[b]);
@@ -2430,6 +2578,13 @@ struct VulkanCommandQueue : IGraphicsCommandQueue
         if (m_running)
             stopRenderer();
 
+        if (m_transientBuf)
+        {
+            vk::UnmapMemory(m_ctx->m_dev, m_transientMem);
+            m_transientBuf.reset();
+            vk::FreeMemory(m_ctx->m_dev, m_transientMem, nullptr);
+        }
+
         vk::DestroyFence(m_ctx->m_dev, m_dynamicBufFence, nullptr);
         vk::DestroyFence(m_ctx->m_dev, m_drawCompleteFence, nullptr);
         vk::DestroySemaphore(m_ctx->m_dev, m_drawCompleteSem, nullptr);
@@ -2444,6 +2599,37 @@ struct VulkanCommandQueue : IGraphicsCommandQueue
         cbind->bind(m_cmdBufs[m_fillBuf], m_fillBuf);
     }
 
+    /* Transient uniforms: one host-coherent, persistently mapped region per
+     * command buffer; the region for m_fillBuf is idle once its frame retires */
+    std::unique_ptr<VulkanGraphicsBufferD> m_transientBuf;
+    VkDeviceMemory m_transientMem = VK_NULL_HANDLE;
+    uint8_t* m_transientMap = nullptr;
+    TransientUniformRing m_transientRing;
+    /* Loader threads may fetch the buffer for bindings while the client allocates */
+    std::once_flag m_transientOnce;
+    VulkanGraphicsBufferD* _transientBuffer();
+
+    IGraphicsBufferD* getTransientUniformBuffer() {return _transientBuffer();}
+
+    TransientUniform allocTransientUniform(size_t size)
+    {
+        VulkanGraphicsBufferD* buf = _transientBuffer();
+        TransientUniform ret;
+        if (!m_transientRing.alloc(size, ret.offset))
+        {
+            Log.report(logvisor::Error, "transient uniform ring exhausted (%d bytes requested)", int(size));
+            return {};
+        }
+        ret.data = m_transientMap + buf->m_memOffset[m_fillBuf] + ret.offset;
+        return ret;
+    }
+
+    void setShaderDataBindingDynamic(IShaderDataBinding* binding, const size_t* dynOffsets, size_t dynOffsetCount)
+    {
+        VulkanShaderDataBinding* cbind = static_cast<VulkanShaderDataBinding*>(binding);
+        cbind->bind(m_cmdBufs[m_fillBuf], m_fillBuf, dynOffsets, dynOffsetCount);
+    }
+
     VulkanTextureR* m_boundTarget = nullptr;
     void setRenderTarget(ITextureR* target)
     {
@@ -2576,6 +2762,69 @@ struct VulkanCommandQueue : IGraphicsCommandQueue
         vk::CmdDrawIndexed(m_cmdBufs[m_fillBuf], count, instCount, start, 0, 0);
     }
 
+    bool supportsDrawIndirect() const {return true;}
+    bool supportsDrawIndirectCount() const {return m_ctx->m_drawIndirectCount;}
+
+    void drawIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        const VkDescriptorBufferInfo* info = GetBufferGPUResource(indirectBuf, m_fillBuf);
+        if (m_ctx->m_enabledFeatures.multiDrawIndirect)
+            vk::CmdDrawIndirect(m_cmdBufs[m_fillBuf], info->buffer, info->offset + offset,
+                                drawCount, sizeof(DrawIndirectCommand));
+        else
+            for (size_t i=0 ; i<drawCount ; ++i)
+                vk::CmdDrawIndirect(m_cmdBufs[m_fillBuf], info->buffer,
+                                    info->offset + offset + i * sizeof(DrawIndirectCommand),
+                                    1, sizeof(DrawIndirectCommand));
+    }
+
+    void drawIndexedIndirect(IGraphicsBuffer* indirectBuf, size_t offset, size_t drawCount)
+    {
+        const VkDescriptorBufferInfo* info = GetBufferGPUResource(indirectBuf, m_fillBuf);
+        if (m_ctx->m_enabledFeatures.multiDrawIndirect)
+            vk::CmdDrawIndexedIndirect(m_cmdBufs[m_fillBuf], info->buffer, info->offset + offset,
+                                       drawCount, sizeof(DrawIndexedIndirectCommand));
+        else
+            for (size_t i=0 ; i<drawCount ; ++i)
+                vk::CmdDrawIndexedIndirect(m_cmdBufs[m_fillBuf], info->buffer,
+                                           info->offset + offset + i * sizeof(DrawIndexedIndirectCommand),
+                                           1, sizeof(DrawIndexedIndirectCommand));
+    }
+
+    void drawIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                           IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+#ifdef VK_KHR_draw_indirect_count
+        if (m_ctx->m_drawIndirectCount)
+        {
+            const VkDescriptorBufferInfo* info = GetBufferGPUResource(indirectBuf, m_fillBuf);
+            const VkDescriptorBufferInfo* countInfo = GetBufferGPUResource(countBuf, m_fillBuf);
+            vk::CmdDrawIndirectCountKHR(m_cmdBufs[m_fillBuf], info->buffer, info->offset + offset,
+                                        countInfo->buffer, countInfo->offset + countOffset,
+                                        maxDrawCount, sizeof(DrawIndirectCommand));
+            return;
+        }
+#endif
+        Log.report(logvisor::Error, "drawIndirectCount unsupported without VK_KHR_draw_indirect_count");
+    }
+
+    void drawIndexedIndirectCount(IGraphicsBuffer* indirectBuf, size_t offset,
+                                  IGraphicsBuffer* countBuf, size_t countOffset, size_t maxDrawCount)
+    {
+#ifdef VK_KHR_draw_indirect_count
+        if (m_ctx->m_drawIndirectCount)
+        {
+            const VkDescriptorBufferInfo* info = GetBufferGPUResource(indirectBuf, m_fillBuf);
+            const VkDescriptorBufferInfo* countInfo = GetBufferGPUResource(countBuf, m_fillBuf);
+            vk::CmdDrawIndexedIndirectCountKHR(m_cmdBufs[m_fillBuf], info->buffer, info->offset + offset,
+                                               countInfo->buffer, countInfo->offset + countOffset,
+                                               maxDrawCount, sizeof(DrawIndexedIndirectCommand));
+            return;
+        }
+#endif
+        Log.report(logvisor::Error, "drawIndexedIndirectCount unsupported without VK_KHR_draw_indirect_count");
+    }
+
     ITextureR* m_resolveDispSource = nullptr;
     void resolveDisplay(ITextureR* source)
     {
@@ -2735,12 +2984,14 @@ struct VulkanCommandQueue : IGraphicsCommandQueue
 
 VulkanGraphicsBufferD::~VulkanGraphicsBufferD()
 {
+    detachDirtyList();
     vk::DestroyBuffer(m_q->m_ctx->m_dev, m_bufferInfo[0].buffer, nullptr);
     vk::DestroyBuffer(m_q->m_ctx->m_dev, m_bufferInfo[1].buffer, nullptr);
 }
 
 VulkanTextureD::~VulkanTextureD()
 {
+    detachDirtyList();
     vk::DestroyImageView(m_q->m_ctx->m_dev, m_gpuView[0], nullptr);
     vk::DestroyImageView(m_q->m_ctx->m_dev, m_gpuView[1], nullptr);
     vk::DestroyBuffer(m_q->m_ctx->m_dev, m_cpuBuf[0], nullptr);
@@ -2842,7 +3093,7 @@ void VulkanGraphicsBufferD::load(const void* data, size_t sz)
 {
     size_t bufSz = std::min(sz, m_cpuSz);
     memmove(m_cpuBuf.get(), data, bufSz);
-    m_validSlots = 0;
+    markDirty();
 }
 void* VulkanGraphicsBufferD::map(size_t sz)
 {
@@ -2852,7 +3103,14 @@ void* VulkanGraphicsBufferD::map(size_t sz)
 }
 void VulkanGraphicsBufferD::unmap()
 {
-    m_validSlots = 0;
+    markDirty();
+}
+
+void VulkanTextureD::_markRegion(size_t x, size_t y, size_t w, size_t h)
+{
+    for (int i=0 ; i<2 ; ++i)
+        m_dirty[i].merge(x, y, w, h);
+    markDirty();
 }
 
 void VulkanTextureD::update(int b)
@@ -2860,17 +3118,31 @@ void VulkanTextureD::update(int b)
     int slot = 1 << b;
     if ((slot & m_validSlots) == 0)
     {
+        TextureDirtyRect& r = m_dirty[b];
+        if (!m_gpuInit[b])
+            r.merge(0, 0, m_width, m_height);
+        if (r.empty())
+        {
+            m_validSlots |= slot;
+            return;
+        }
+
         m_q->stallDynamicUpload();
         VkCommandBuffer cmdBuf = m_q->m_dynamicCmdBufs[b];
 
-        /* map memory and copy staging data */
+        /* Pack the dirty rectangle at the start of this image's staging buffer */
+        size_t w = r.x1 - r.x0;
+        size_t h = r.y1 - r.y0;
+        size_t rowSz = w * m_pxPitch;
         uint8_t* mappedData;
-        ThrowIfFailed(vk::MapMemory(m_q->m_ctx->m_dev, m_cpuMem, m_cpuOffsets[b], m_cpuSz, 0, reinterpret_cast<void**>(&mappedData)));
-        memmove(mappedData, m_stagingBuf.get(), m_cpuSz);
+        ThrowIfFailed(vk::MapMemory(m_q->m_ctx->m_dev, m_cpuMem, m_cpuOffsets[b], rowSz * h, 0, reinterpret_cast<void**>(&mappedData)));
+        const uint8_t* srcRow = m_stagingBuf.get() + r.y0 * m_srcRowPitch + r.x0 * m_pxPitch;
+        for (size_t i=0 ; i<h ; ++i, mappedData += rowSz, srcRow += m_srcRowPitch)
+            memmove(mappedData, srcRow, rowSz);
         vk::UnmapMemory(m_q->m_ctx->m_dev, m_cpuMem);
 
         SetImageLayout(cmdBuf, m_gpuTex[b], VK_IMAGE_ASPECT_COLOR_BIT,
-                       VK_IMAGE_LAYOUT_UNDEFINED,
+                       m_gpuInit[b] ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, 1);
 
         /* Put the copy command into the command buffer */
@@ -2879,8 +3151,10 @@ void VulkanTextureD::update(int b)
         copyRegion.imageSubresource.mipLevel = 0;
         copyRegion.imageSubresource.baseArrayLayer = 0;
         copyRegion.imageSubresource.layerCount = 1;
-        copyRegion.imageExtent.width = m_width;
-        copyRegion.imageExtent.height = m_height;
+        copyRegion.imageOffset.x = int32_t(r.x0);
+        copyRegion.imageOffset.y = int32_t(r.y0);
+        copyRegion.imageExtent.width = w;
+        copyRegion.imageExtent.height = h;
         copyRegion.imageExtent.depth = 1;
         copyRegion.bufferOffset = 0;
 
@@ -2897,6 +3171,8 @@ void VulkanTextureD::update(int b)
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, 1);
 
+        r.clear();
+        m_gpuInit[b] = true;
         m_validSlots |= slot;
     }
 }
@@ -2904,7 +3180,7 @@ void VulkanTextureD::load(const void* data, size_t sz)
 {
     size_t bufSz = std::min(sz, m_cpuSz);
     memmove(m_stagingBuf.get(), data, bufSz);
-    m_validSlots = 0;
+    _markRegion(0, 0, m_width, m_height);
 }
 void* VulkanTextureD::map(size_t sz)
 {
@@ -2914,7 +3190,12 @@ void* VulkanTextureD::map(size_t sz)
 }
 void VulkanTextureD::unmap()
 {
-    m_validSlots = 0;
+    _markRegion(0, 0, m_width, m_height);
+}
+void VulkanTextureD::loadRegion(size_t x, size_t y, size_t w, size_t h, const void* data, size_t pitch)
+{
+    if (CopyTextureRegion(m_stagingBuf.get(), m_width, m_height, m_pxPitch, x, y, w, h, data, pitch))
+        _markRegion(x, y, w, h);
 }
 
 void VulkanDataFactoryImpl::destroyData(IGraphicsData* d)
@@ -2923,6 +3204,16 @@ void VulkanDataFactoryImpl::destroyData(IGraphicsData* d)
     data->m_dead = true;
 }
 
+bool VulkanDataFactoryImpl::isDataReady(IGraphicsData* d)
+{
+    return static_cast<VulkanData*>(d)->uploadReady();
+}
+
+void VulkanDataFactoryImpl::waitData(IGraphicsData* d)
+{
+    static_cast<VulkanData*>(d)->waitUpload();
+}
+
 void VulkanDataFactoryImpl::destroyPool(IGraphicsBufferPool* p)
 {
     VulkanPool* pool = static_cast<VulkanPool*>(p);
@@ -2948,7 +3239,8 @@ VulkanDataFactoryImpl::VulkanDataFactoryImpl(IGraphicsContext* parent,
     for (int i=0 ; i<BOO_GLSL_MAX_UNIFORM_COUNT ; ++i)
     {
         layoutBindings[i].binding = i;
-        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        /* Dynamic so transient-ring uniforms can be offset per draw */
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         layoutBindings[i].descriptorCount = 1;
         layoutBindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
         layoutBindings[i].pImmutableSamplers = nullptr;
@@ -3018,8 +3310,8 @@ VulkanDataFactoryImpl::VulkanDataFactoryImpl(IGraphicsContext* parent,
     ThrowIfFailed(vk::CreateRenderPass(ctx->m_dev, &renderPass, nullptr, &ctx->m_pass));
 }
 
-static uint64_t CompileVert(std::vector<unsigned int>& out, const char* vertSource, uint64_t srcKey,
-                            VulkanDataFactoryImpl& factory)
+/* Touches no factory state so both stages may compile concurrently */
+static uint64_t CompileVert(std::vector<unsigned int>& out, const char* vertSource)
 {
     const EShMessages messages = EShMessages(EShMsgSpvRules | EShMsgVulkanRules);
     glslang::TShader vs(EShLangVertex);
@@ -3042,13 +3334,11 @@ static uint64_t CompileVert(std::vector<unsigned int>& out, const char* vertSour
     XXH64_state_t hashState;
     XXH64_reset(&hashState, 0);
     XXH64_update(&hashState, out.data(), out.size() * sizeof(unsigned int));
-    uint64_t binKey = XXH64_digest(&hashState);
-    factory.m_sourceToBinary[srcKey] = binKey;
-    return binKey;
+    return XXH64_digest(&hashState);
 }
 
-static uint64_t CompileFrag(std::vector<unsigned int>& out, const char* fragSource, uint64_t srcKey,
-                            VulkanDataFactoryImpl& factory)
+/* Touches no factory state so both stages may compile concurrently */
+static uint64_t CompileFrag(std::vector<unsigned int>& out, const char* fragSource)
 {
     const EShMessages messages = EShMessages(EShMsgSpvRules | EShMsgVulkanRules);
     glslang::TShader fs(EShLangFragment);
@@ -3071,9 +3361,7 @@ static uint64_t CompileFrag(std::vector<unsigned int>& out, const char* fragSour
     XXH64_state_t hashState;
     XXH64_reset(&hashState, 0);
     XXH64_update(&hashState, out.data(), out.size() * sizeof(unsigned int));
-    uint64_t binKey = XXH64_digest(&hashState);
-    factory.m_sourceToBinary[srcKey] = binKey;
-    return binKey;
+    return XXH64_digest(&hashState);
 }
 
 IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
@@ -3084,6 +3372,7 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
  bool depthTest, bool depthWrite, CullMode culling)
 {
     VulkanDataFactoryImpl& factory = static_cast<VulkanDataFactoryImpl&>(m_parent);
+    std::unique_lock<std::recursive_mutex> sharedLk(factory.m_sharedLock);
 
     XXH64_state_t hashState;
     uint64_t srcHashes[2] = {};
@@ -3117,11 +3406,38 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
         binHashes[1] = XXH64_digest(&hashState);
     }
 
-    if (vertBlobOut && vertBlobOut->empty())
-        binHashes[0] = CompileVert(*vertBlobOut, vertSource, srcHashes[0], factory);
+    /* Stages are compiled when the caller wants the blob or no module exists yet */
+    std::vector<unsigned int> vertBlob;
+    std::vector<unsigned int> fragBlob;
+    std::vector<unsigned int>* useVertBlob = vertBlobOut ? vertBlobOut : &vertBlob;
+    std::vector<unsigned int>* useFragBlob = fragBlobOut ? fragBlobOut : &fragBlob;
+    bool compileVert = vertBlobOut ? vertBlobOut->empty() :
+        (!binHashes[0] || factory.m_sharedShaders.find(binHashes[0]) == factory.m_sharedShaders.end());
+    bool compileFrag = fragBlobOut ? fragBlobOut->empty() :
+        (!binHashes[1] || factory.m_sharedShaders.find(binHashes[1]) == factory.m_sharedShaders.end());
+
+    if (compileVert && compileFrag)
+    {
+        TaskScheduler::Shared().parallelFor(2, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i=begin ; i<end ; ++i)
+            {
+                if (i == 0)
+                    binHashes[0] = CompileVert(*useVertBlob, vertSource);
+                else
+                    binHashes[1] = CompileFrag(*useFragBlob, fragSource);
+            }
+        }, TaskPriority::Normal);
+    }
+    else if (compileVert)
+        binHashes[0] = CompileVert(*useVertBlob, vertSource);
+    else if (compileFrag)
+        binHashes[1] = CompileFrag(*useFragBlob, fragSource);
 
-    if (fragBlobOut && fragBlobOut->empty())
-        binHashes[1] = CompileFrag(*fragBlobOut, fragSource, srcHashes[1], factory);
+    if (compileVert)
+        factory.m_sourceToBinary[srcHashes[0]] = binHashes[0];
+    if (compileFrag)
+        factory.m_sourceToBinary[srcHashes[1]] = binHashes[1];
 
     VkShaderModuleCreateInfo smCreateInfo = {};
     smCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -3138,18 +3454,6 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
     }
     else
     {
-        std::vector<unsigned int> vertBlob;
-        const std::vector<unsigned int>* useVertBlob;
-        if (vertBlobOut)
-        {
-            useVertBlob = vertBlobOut;
-        }
-        else
-        {
-            useVertBlob = &vertBlob;
-            binHashes[0] = CompileVert(vertBlob, vertSource, srcHashes[0], factory);
-        }
-
         smCreateInfo.codeSize = useVertBlob->size() * sizeof(unsigned int);
         smCreateInfo.pCode = useVertBlob->data();
         VkShaderModule vertModule;
@@ -3169,18 +3473,6 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
     }
     else
     {
-        std::vector<unsigned int> fragBlob;
-        const std::vector<unsigned int>* useFragBlob;
-        if (fragBlobOut)
-        {
-            useFragBlob = fragBlobOut;
-        }
-        else
-        {
-            useFragBlob = &fragBlob;
-            binHashes[1] = CompileFrag(fragBlob, fragSource, srcHashes[1], factory);
-        }
-
         smCreateInfo.codeSize = useFragBlob->size() * sizeof(unsigned int);
         smCreateInfo.pCode = useFragBlob->data();
         VkShaderModule fragModule;
@@ -3194,25 +3486,53 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
     }
 
 
-    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
-    if (pipelineBlob)
-    {
-        VkPipelineCacheCreateInfo cacheDataInfo = {};
-        cacheDataInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-        cacheDataInfo.pNext = nullptr;
+    const VulkanVertexFormat* vkVtxFmt = static_cast<const VulkanVertexFormat*>(vtxFmt);
 
-        cacheDataInfo.initialDataSize = pipelineBlob->size();
-        if (cacheDataInfo.initialDataSize)
-            cacheDataInfo.pInitialData = pipelineBlob->data();
+    /* Identical binaries, vertex layout and state resolve to one VkPipeline */
+    XXH64_reset(&hashState, 0);
+    XXH64_update(&hashState, binHashes, sizeof(binHashes));
+    XXH64_update(&hashState, vkVtxFmt->m_info.pVertexBindingDescriptions,
+                 vkVtxFmt->m_info.vertexBindingDescriptionCount * sizeof(VkVertexInputBindingDescription));
+    XXH64_update(&hashState, vkVtxFmt->m_info.pVertexAttributeDescriptions,
+                 vkVtxFmt->m_info.vertexAttributeDescriptionCount * sizeof(VkVertexInputAttributeDescription));
+    int state[] = {int(srcFac), int(dstFac), int(prim), depthTest, depthWrite, int(culling)};
+    XXH64_update(&hashState, state, sizeof(state));
+    uint64_t pipelineKey = XXH64_digest(&hashState);
 
-        ThrowIfFailed(vk::CreatePipelineCache(factory.m_ctx->m_dev, &cacheDataInfo, nullptr, &pipelineCache));
+    VulkanShareablePipeline::Token pipeline;
+    auto pipelineFind = factory.m_sharedPipelines.m_pipelines.find(pipelineKey);
+    if (pipelineFind != factory.m_sharedPipelines.m_pipelines.end())
+    {
+        pipeline = pipelineFind->second->lock();
     }
+    else
+    {
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        if (pipelineBlob)
+        {
+            VkPipelineCacheCreateInfo cacheDataInfo = {};
+            cacheDataInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            cacheDataInfo.pNext = nullptr;
+
+            cacheDataInfo.initialDataSize = pipelineBlob->size();
+            if (cacheDataInfo.initialDataSize)
+                cacheDataInfo.pInitialData = pipelineBlob->data();
 
-    VulkanShaderPipeline* retval = new VulkanShaderPipeline(factory.m_ctx, std::move(vertShader), std::move(fragShader),
-                                                            pipelineCache, static_cast<const VulkanVertexFormat*>(vtxFmt),
-                                                            srcFac, dstFac, prim, depthTest, depthWrite, culling);
+            ThrowIfFailed(vk::CreatePipelineCache(factory.m_ctx->m_dev, &cacheDataInfo, nullptr, &pipelineCache));
+        }
+
+        auto it =
+        factory.m_sharedPipelines.m_pipelines.emplace(std::make_pair(pipelineKey,
+            std::make_unique<VulkanShareablePipeline>(factory.m_sharedPipelines, pipelineKey, factory.m_ctx,
+                                                      std::move(vertShader), std::move(fragShader),
+                                                      pipelineCache, vkVtxFmt,
+                                                      srcFac, dstFac, prim, depthTest, depthWrite, culling))).first;
+        pipeline = it->second->lock();
+    }
 
-    if (pipelineBlob && pipelineBlob->empty())
+    /* A deduplicated pipeline can still hand back its cache if it was created with one */
+    VkPipelineCache pipelineCache = pipeline.get().m_pipelineCache;
+    if (pipelineBlob && pipelineBlob->empty() && pipelineCache)
     {
         size_t cacheSz = 0;
         ThrowIfFailed(vk::GetPipelineCacheData(factory.m_ctx->m_dev, pipelineCache, &cacheSz, nullptr));
@@ -3224,6 +3544,8 @@ IShaderPipeline* VulkanDataFactory::Context::newShaderPipeline
         }
     }
 
+    VulkanShaderPipeline* retval = new VulkanShaderPipeline(std::move(pipeline), vkVtxFmt);
+
     static_cast<VulkanData*>(VulkanDataFactoryImpl::m_deferredData.get())->m_SPs.emplace_back(retval);
     return retval;
 }
@@ -3310,9 +3632,66 @@ IShaderDataBinding* VulkanDataFactory::Context::newShaderDataBinding(IShaderPipe
     return retval;
 }
 
+bool VulkanData::uploadReady()
+{
+    if (!m_uploadPending.load())
+        return true;
+    if (vk::GetFenceStatus(m_ctx->m_dev, m_uploadFence) != VK_SUCCESS)
+        return false;
+    retireUploads();
+    return true;
+}
+
+void VulkanData::waitUpload()
+{
+    if (!m_uploadPending.load())
+        return;
+    ThrowIfFailed(vk::WaitForFences(m_ctx->m_dev, 1, &m_uploadFence, VK_TRUE, UINT64_MAX));
+    retireUploads();
+}
+
+void VulkanData::retireUploads()
+{
+    if (!m_uploadPending.exchange(false))
+        return;
+
+    /* Delete upload objects */
+    for (std::unique_ptr<VulkanTextureS>& tex : m_STexs)
+        tex->deleteUploadObjects();
+
+    for (std::unique_ptr<VulkanTextureSA>& tex : m_SATexs)
+        tex->deleteUploadObjects();
+}
+
+/* Recycle a load context's command buffers whose uploads have completed;
+ * called from the owning thread and from the render thread */
+static void RetireLoads(VulkanContext::LoadContext& loadCtx)
+{
+    std::vector<VulkanData*> retired;
+    {
+        std::unique_lock<std::mutex> lk(loadCtx.m_retireLock);
+        for (auto it = loadCtx.m_inFlight.begin() ; it != loadCtx.m_inFlight.end() ;)
+        {
+            if (!it->second->uploadReady())
+            {
+                ++it;
+                continue;
+            }
+            loadCtx.m_freeCmdBufs.push_back(it->first);
+            retired.push_back(it->second);
+            it = loadCtx.m_inFlight.erase(it);
+        }
+    }
+
+    /* Releasing the last reference destroys the data; do it outside the lock */
+    for (VulkanData* data : retired)
+        data->decrement();
+}
+
 GraphicsDataToken VulkanDataFactoryImpl::commitTransaction
     (const std::function<bool(IGraphicsDataFactory::Context&)>& trans)
 {
+    BOO_TRACE_ZONE("Vulkan commitTransaction");
     if (m_deferredData.get())
         Log.report(logvisor::Fatal, "nested commitTransaction usage detected");
     m_deferredData.reset(new VulkanData(m_ctx));
@@ -3364,8 +3743,12 @@ GraphicsDataToken VulkanDataFactoryImpl::commitTransaction
         uint8_t* mappedData;
         ThrowIfFailed(vk::MapMemory(m_ctx->m_dev, retval->m_bufMem, 0, bufMemSize, 0, reinterpret_cast<void**>(&mappedData)));
 
-        for (std::unique_ptr<VulkanGraphicsBufferS>& buf : retval->m_SBufs)
-            buf->placeForGPU(m_ctx, retval->m_bufMem, mappedData);
+        /* Static data copies are independent; spread large transactions over the pool */
+        TaskScheduler::Shared().parallelFor(retval->m_SBufs.size(), 16, [&](size_t begin, size_t end)
+        {
+            for (size_t i=begin ; i<end ; ++i)
+                retval->m_SBufs[i]->placeForGPU(m_ctx, retval->m_bufMem, mappedData);
+        }, TaskPriority::Normal);
 
         vk::UnmapMemory(m_ctx->m_dev, retval->m_bufMem);
 
@@ -3392,44 +3775,55 @@ GraphicsDataToken VulkanDataFactoryImpl::commitTransaction
             tex->placeForGPU(m_ctx, retval->m_texMem);
     }
 
-    /* Execute static uploads */
-    ThrowIfFailed(vk::EndCommandBuffer(m_ctx->m_loadCmdBuf));
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_ctx->m_loadCmdBuf;
-
-    /* Take exclusive lock here and submit queue */
-    std::unique_lock<std::mutex> qlk(m_ctx->m_queueLock);
-    ThrowIfFailed(vk::QueueWaitIdle(m_ctx->m_queue));
-    ThrowIfFailed(vk::QueueSubmit(m_ctx->m_queue, 1, &submitInfo, VK_NULL_HANDLE));
-
     /* Commit data bindings (create descriptor sets) */
     for (std::unique_ptr<VulkanShaderDataBinding>& bind : retval->m_SBinds)
         bind->commit(m_ctx);
 
-    /* Wait for uploads to complete */
-    ThrowIfFailed(vk::QueueWaitIdle(m_ctx->m_queue));
-    qlk.unlock();
+    /* Submit static uploads from this thread's load context without waiting;
+     * the layout barriers order them ahead of any later draw on the queue */
+    if (retval->m_STexs.size() || retval->m_SATexs.size())
+    {
+        VulkanContext::LoadContext& loadCtx = m_ctx->getLoadContext();
+        ThrowIfFailed(vk::EndCommandBuffer(loadCtx.m_cmdBuf));
 
-    /* Reset command buffer */
-    ThrowIfFailed(vk::ResetCommandBuffer(m_ctx->m_loadCmdBuf, 0));
-    VkCommandBufferBeginInfo cmdBufBeginInfo = {};
-    cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    cmdBufBeginInfo.flags = 0;
-    ThrowIfFailed(vk::BeginCommandBuffer(m_ctx->m_loadCmdBuf, &cmdBufBeginInfo));
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.pNext = nullptr;
+        fenceInfo.flags = 0;
+        ThrowIfFailed(vk::CreateFence(m_ctx->m_dev, &fenceInfo, nullptr, &retval->m_uploadFence));
+        retval->m_uploadPending = true;
 
-    /* Delete upload objects */
-    for (std::unique_ptr<VulkanTextureS>& tex : retval->m_STexs)
-        tex->deleteUploadObjects();
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &loadCtx.m_cmdBuf;
 
-    for (std::unique_ptr<VulkanTextureSA>& tex : retval->m_SATexs)
-        tex->deleteUploadObjects();
+        /* Queue access is externally synchronized; hold the lock only to submit */
+        {
+            std::unique_lock<std::mutex> qlk(m_ctx->m_queueLock);
+            ThrowIfFailed(vk::QueueSubmit(m_ctx->m_queue, 1, &submitInfo, retval->m_uploadFence));
+        }
+
+        /* In-flight entry keeps the data (and its staging) alive until retired */
+        retval->increment();
+        {
+            std::unique_lock<std::mutex> rlk(loadCtx.m_retireLock);
+            loadCtx.m_inFlight.push_back({loadCtx.m_cmdBuf, retval});
+        }
+        RetireLoads(loadCtx);
+        loadCtx.beginCmdBuf(m_ctx->m_dev);
+    }
+    else if (VulkanContext::LoadContext* loadCtx = m_ctx->m_threadLoadCtx.get())
+        RetireLoads(*loadCtx);
 
     /* All set! */
     m_deferredData.reset();
     std::unique_lock<std::mutex> lk(m_committedMutex);
     m_committedData.insert(retval);
+    for (std::unique_ptr<VulkanGraphicsBufferD>& b : retval->m_DBufs)
+        b->attachDirtyList(m_dirtyResources);
+    for (std::unique_ptr<VulkanTextureD>& t : retval->m_DTexs)
+        t->attachDirtyList(m_dirtyResources);
     return GraphicsDataToken(this, retval);
 }
 
@@ -3462,6 +3856,7 @@ IGraphicsBufferD* VulkanDataFactoryImpl::newPoolBuffer(IGraphicsBufferPool* p, B
     }
 
     pool->m_DBufs.emplace(std::make_pair(retval, VulkanPool::Buffer{bufMem, retval}));
+    retval->attachDirtyList(m_dirtyResources);
     return retval;
 }
 
@@ -3483,27 +3878,53 @@ GraphicsBufferPoolToken VulkanDataFactoryImpl::newBufferPool()
 
 ThreadLocalPtr<struct VulkanData> VulkanDataFactoryImpl::m_deferredData;
 
+VulkanGraphicsBufferD* VulkanCommandQueue::_transientBuffer()
+{
+    std::call_once(m_transientOnce, [this]()
+    {
+        m_transientBuf.reset(new VulkanGraphicsBufferD(this, BufferUse::Uniform, m_ctx,
+                                                       TransientUniformRing::FrameSize, 1));
+        m_transientBuf->m_transient = true;
+
+        uint32_t memTypeBits = ~0;
+        VkMemoryAllocateInfo memAlloc = {};
+        memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memAlloc.allocationSize = m_transientBuf->sizeForGPU(m_ctx, memTypeBits, 0);
+        ThrowIfFalse(MemoryTypeFromProperties(m_ctx, memTypeBits,
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                              &memAlloc.memoryTypeIndex));
+        ThrowIfFailed(vk::AllocateMemory(m_ctx->m_dev, &memAlloc, nullptr, &m_transientMem));
+        m_transientBuf->placeForGPU(m_ctx, m_transientMem);
+        ThrowIfFailed(vk::MapMemory(m_ctx->m_dev, m_transientMem, 0, memAlloc.allocationSize, 0,
+                                    reinterpret_cast<void**>(&m_transientMap)));
+
+        m_transientRing.init(TransientUniformRing::FrameSize, m_ctx->m_gpuProps.limits.minUniformBufferOffsetAlignment);
+    });
+    return m_transientBuf.get();
+}
+
 void VulkanCommandQueue::execute()
 {
+    BOO_TRACE_ZONE("Vulkan execute");
     if (!m_running)
         return;
 
-    /* Stage dynamic uploads */
+    /* The recorded frame either retires or is abandoned below; either way the
+     * next allocations target a region the GPU no longer reads */
+    m_transientRing.reset();
+
+    /* Stage dynamic uploads (only resources loaded since both copies were current) */
     VulkanDataFactoryImpl* gfxF = static_cast<VulkanDataFactoryImpl*>(m_parent->getDataFactory());
-    std::unique_lock<std::mutex> datalk(gfxF->m_committedMutex);
-    for (VulkanData* d : gfxF->m_committedData)
-    {
-        for (std::unique_ptr<VulkanGraphicsBufferD>& b : d->m_DBufs)
-            b->update(m_fillBuf);
-        for (std::unique_ptr<VulkanTextureD>& t : d->m_DTexs)
-            t->update(m_fillBuf);
-    }
-    for (VulkanPool* p : gfxF->m_committedPools)
+    gfxF->m_dirtyResources.update(m_fillBuf, 0x3);
+
+    /* Release completed static uploads, including those of loader threads
+     * that have gone idle or exited */
     {
-        for (auto& b : p->m_DBufs)
-            b.second.m_buffer->update(m_fillBuf);
+        std::unique_lock<std::mutex> llk(m_ctx->m_loadCtxLock);
+        for (std::unique_ptr<VulkanContext::LoadContext>& loadCtx : m_ctx->m_loadCtxs)
+            RetireLoads(*loadCtx);
     }
-    datalk.unlock();
 
     /* Perform dynamic uploads */
     std::unique_lock<std::mutex> lk(m_ctx->m_queueLock);
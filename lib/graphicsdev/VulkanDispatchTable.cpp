@@ -183,6 +183,10 @@ PFN_vkGetPhysicalDeviceWin32PresentationSupportKHR GetPhysicalDeviceWin32Present
 PFN_vkCreateDebugReportCallbackEXT CreateDebugReportCallbackEXT;
 PFN_vkDestroyDebugReportCallbackEXT DestroyDebugReportCallbackEXT;
 PFN_vkDebugReportMessageEXT DebugReportMessageEXT;
+#ifdef VK_KHR_draw_indirect_count
+PFN_vkCmdDrawIndirectCountKHR CmdDrawIndirectCountKHR;
+PFN_vkCmdDrawIndexedIndirectCountKHR CmdDrawIndexedIndirectCountKHR;
+#endif
 
 void init_dispatch_table_top(PFN_vkGetInstanceProcAddr get_instance_proc_addr)
 {
@@ -520,6 +524,10 @@ void init_dispatch_table_bottom(VkInstance instance, VkDevice dev)
     AcquireNextImageKHR = reinterpret_cast<PFN_vkAcquireNextImageKHR>(GetDeviceProcAddr(dev, "vkAcquireNextImageKHR"));
     QueuePresentKHR = reinterpret_cast<PFN_vkQueuePresentKHR>(GetDeviceProcAddr(dev, "vkQueuePresentKHR"));
     CreateSharedSwapchainsKHR = reinterpret_cast<PFN_vkCreateSharedSwapchainsKHR>(GetDeviceProcAddr(dev, "vkCreateSharedSwapchainsKHR"));
+#ifdef VK_KHR_draw_indirect_count
+    CmdDrawIndirectCountKHR = reinterpret_cast<PFN_vkCmdDrawIndirectCountKHR>(GetDeviceProcAddr(dev, "vkCmdDrawIndirectCountKHR"));
+    CmdDrawIndexedIndirectCountKHR = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(GetDeviceProcAddr(dev, "vkCmdDrawIndexedIndirectCountKHR"));
+#endif
 }
 
 } // namespace vk
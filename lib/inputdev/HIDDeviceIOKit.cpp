@@ -1,6 +1,7 @@
 #include "IHIDDevice.hpp"
 #include "boo/inputdev/DeviceToken.hpp"
 #include "boo/inputdev/DeviceBase.hpp"
+#include "boo/Trace.hpp"
 #include <IOKit/hid/IOHIDLib.h>
 #include <IOKit/usb/IOUSBLib.h>
 #include <IOKit/IOCFPlugIn.h>
@@ -161,9 +162,13 @@ class HIDDeviceIOKit : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
         /* Cleanup */
@@ -184,9 +189,13 @@ class HIDDeviceIOKit : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
     }
@@ -201,9 +210,13 @@ class HIDDeviceIOKit : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
     }
 
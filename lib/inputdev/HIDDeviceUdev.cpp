@@ -1,6 +1,7 @@
 #include "IHIDDevice.hpp"
 #include "boo/inputdev/DeviceToken.hpp"
 #include "boo/inputdev/DeviceBase.hpp"
+#include "boo/Trace.hpp"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -138,9 +139,13 @@ class HIDDeviceUdev final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
         /* Cleanup */
@@ -161,9 +166,13 @@ class HIDDeviceUdev final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
         udev_device_unref(udevDev);
@@ -180,9 +189,13 @@ class HIDDeviceUdev final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
         udev_device_unref(udevDev);
@@ -2,6 +2,7 @@
 #include "IHIDDevice.hpp"
 #include "boo/inputdev/DeviceToken.hpp"
 #include "boo/inputdev/DeviceBase.hpp"
+#include "boo/Trace.hpp"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -131,9 +132,13 @@ class HIDDeviceWinUSB final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
         /* Cleanup */
@@ -153,9 +158,13 @@ class HIDDeviceWinUSB final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
     }
@@ -170,9 +179,13 @@ class HIDDeviceWinUSB final : public IHIDDevice
         device->m_initCond.notify_one();
 
         /* Start transfer loop */
+        BOO_TRACE_THREAD_NAME("boo HID Device");
         device->m_devImp.initialCycle();
         while (device->m_runningTransferLoop)
+        {
+            BOO_TRACE_ZONE("HID Transfer Cycle");
             device->m_devImp.transferCycle();
+        }
         device->m_devImp.finalCycle();
 
     }
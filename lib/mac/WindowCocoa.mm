@@ -8,7 +8,10 @@
 #include "boo/IWindow.hpp"
 #include "boo/IGraphicsContext.hpp"
 #include "boo/audiodev/IAudioVoiceEngine.hpp"
+#include "boo/ThreadLocalPtr.hpp"
+#include "boo/Trace.hpp"
 #include "logvisor/logvisor.hpp"
+#include <vector>
 
 #if !__has_feature(objc_arc)
 #error ARC Required
@@ -199,7 +202,10 @@ class GraphicsContextCocoaGL : public GraphicsContextCocoa
     IGraphicsCommandQueue* m_commandQueue = nullptr;
     IGraphicsDataFactory* m_dataFactory = nullptr;
     NSOpenGLContext* m_mainCtx = nullptr;
-    NSOpenGLContext* m_loadCtx = nullptr;
+    /* One load context per client loading thread; the vector holds the strong refs */
+    std::mutex m_loadCtxLock;
+    std::vector<NSOpenGLContext*> m_loadCtxs;
+    ThreadLocalPtr<void> m_threadLoadCtx;
 
 public:
     NSOpenGLContext* m_lastCtx = nullptr;
@@ -287,14 +293,18 @@ public:
 
     IGraphicsDataFactory* getLoadContextDataFactory()
     {
-        if (!m_loadCtx)
+        NSOpenGLContext* loadCtx = (__bridge NSOpenGLContext*)m_threadLoadCtx.get();
+        if (!loadCtx)
         {
             NSOpenGLPixelFormat* nspf = [[NSOpenGLPixelFormat alloc] initWithAttributes:PF_TABLE[int(m_pf)]];
-            m_loadCtx = [[NSOpenGLContext alloc] initWithFormat:nspf shareContext:[m_nsContext openGLContext]];
-            if (!m_loadCtx)
+            loadCtx = [[NSOpenGLContext alloc] initWithFormat:nspf shareContext:[m_nsContext openGLContext]];
+            if (!loadCtx)
                 Log.report(logvisor::Fatal, "unable to make load NSOpenGLContext");
+            m_threadLoadCtx.reset((__bridge void*)loadCtx);
+            std::unique_lock<std::mutex> lk(m_loadCtxLock);
+            m_loadCtxs.push_back(loadCtx);
         }
-        [m_loadCtx makeCurrentContext];
+        [loadCtx makeCurrentContext];
         return m_dataFactory;
     }
 
@@ -663,6 +673,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)mouseDown:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -681,6 +692,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)mouseUp:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -699,6 +711,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)rightMouseDown:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -717,6 +730,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)rightMouseUp:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -735,6 +749,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)otherMouseDown:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     boo::EMouseButton button = getButton(theEvent);
@@ -755,6 +770,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)otherMouseUp:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     boo::EMouseButton button = getButton(theEvent);
@@ -775,6 +791,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)mouseMoved:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -810,6 +827,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)mouseEntered:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -826,6 +844,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)mouseExited:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -842,6 +861,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)scrollWheel:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSPoint liw = [parentView convertPoint:[theEvent locationInWindow] fromView:nil];
@@ -864,6 +884,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)touchesBeganWithEvent:(NSEvent*)event
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     for (NSTouch* touch in [event touchesMatchingPhase:NSTouchPhaseBegan inView:nil])
@@ -879,6 +900,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)touchesEndedWithEvent:(NSEvent*)event
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     for (NSTouch* touch in [event touchesMatchingPhase:NSTouchPhaseEnded inView:nil])
@@ -894,6 +916,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)touchesMovedWithEvent:(NSEvent*)event
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     for (NSTouch* touch in [event touchesMatchingPhase:NSTouchPhaseMoved inView:nil])
@@ -909,6 +932,7 @@ static inline boo::EMouseButton getButton(NSEvent* event)
 
 - (void)touchesCancelledWithEvent:(NSEvent*)event
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     for (NSTouch* touch in [event touchesMatchingPhase:NSTouchPhaseCancelled inView:nil])
@@ -1032,6 +1056,7 @@ static boo::ESpecialKey translateKeycode(short code)
 
 - (void)keyDown:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     boo::ESpecialKey special = translateKeycode(theEvent.keyCode);
@@ -1054,6 +1079,7 @@ static boo::ESpecialKey translateKeycode(short code)
 
 - (void)keyUp:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     boo::ESpecialKey special = translateKeycode(theEvent.keyCode);
@@ -1074,6 +1100,7 @@ static boo::ESpecialKey translateKeycode(short code)
 
 - (void)flagsChanged:(NSEvent*)theEvent
 {
+    BOO_TRACE_ZONE("Window Event");
     if (!booContext->m_callback)
         return;
     NSUInteger modFlags = theEvent.modifierFlags;
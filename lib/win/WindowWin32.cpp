@@ -3,6 +3,8 @@
 #include "boo/IApplication.hpp"
 #include "boo/IWindow.hpp"
 #include "boo/IGraphicsContext.hpp"
+#include "boo/Trace.hpp"
+#include "boo/ThreadLocalPtr.hpp"
 #include "logvisor/logvisor.hpp"
 
 #include "boo/graphicsdev/D3D.hpp"
@@ -10,6 +12,8 @@
 #include "boo/graphicsdev/glew.h"
 #include "boo/graphicsdev/wglew.h"
 #include "boo/audiodev/IAudioVoiceEngine.hpp"
+#include <mutex>
+#include <vector>
 
 #if BOO_HAS_VULKAN
 #include "boo/graphicsdev/Vulkan.hpp"
@@ -356,7 +360,7 @@ public:
         return m_dataFactory;
     }
 
-    /* Creates a new context on current thread!! Call from client loading thread */
+    /* Creates a new context on current thread!! Call from main client thread */
     HGLRC m_mainCtx = 0;
     IGraphicsDataFactory* getMainContextDataFactory()
     {
@@ -372,18 +376,24 @@ public:
         return m_dataFactory;
     }
 
-    /* Creates a new context on current thread!! Call from client loading thread */
-    HGLRC m_loadCtx = 0;
+    /* Creates a new context for each calling thread!! Call from client loading threads */
+    std::mutex m_loadCtxLock;
+    std::vector<HGLRC> m_loadCtxs;
+    ThreadLocalPtr<std::remove_pointer<HGLRC>::type> m_threadLoadCtx;
     IGraphicsDataFactory* getLoadContextDataFactory()
     {
         OGLContext::Window& w = m_3dCtx.m_ctxOgl.m_windows[m_parentWindow];
-        if (!m_loadCtx)
+        HGLRC loadCtx = m_threadLoadCtx.get();
+        if (!loadCtx)
         {
-            m_loadCtx = wglCreateContextAttribsARB(w.m_deviceContext, w.m_mainContext, ContextAttribs);
-            if (!m_loadCtx)
+            loadCtx = wglCreateContextAttribsARB(w.m_deviceContext, w.m_mainContext, ContextAttribs);
+            if (!loadCtx)
                 Log.report(logvisor::Fatal, "unable to make load WGL context");
+            m_threadLoadCtx.reset(loadCtx);
+            std::unique_lock<std::mutex> lk(m_loadCtxLock);
+            m_loadCtxs.push_back(loadCtx);
         }
-        if (!wglMakeCurrent(w.m_deviceContext, m_loadCtx))
+        if (!wglMakeCurrent(w.m_deviceContext, loadCtx))
             Log.report(logvisor::Fatal, "unable to make load WGL context current");
         return m_dataFactory;
     }
@@ -1293,6 +1303,7 @@ public:
     bool mouseTracking = false;
     void _incomingEvent(void* ev)
     {
+        BOO_TRACE_ZONE("Window Event");
         HWNDEvent& e = *static_cast<HWNDEvent*>(ev);
         switch (e.uMsg)
         {
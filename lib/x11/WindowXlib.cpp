@@ -3,6 +3,8 @@
 #include "boo/IApplication.hpp"
 #include "boo/graphicsdev/GL.hpp"
 #include "boo/audiodev/IAudioVoiceEngine.hpp"
+#include "boo/Trace.hpp"
+#include "boo/ThreadLocalPtr.hpp"
 
 #if BOO_HAS_VULKAN
 #include "boo/graphicsdev/Vulkan.hpp"
@@ -18,6 +20,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 #include <GL/glx.h>
 
@@ -316,7 +319,10 @@ struct GraphicsContextXlibGLX : GraphicsContextXlib
     IGraphicsCommandQueue* m_commandQueue = nullptr;
     IGraphicsDataFactory* m_dataFactory = nullptr;
     GLXContext m_mainCtx = 0;
-    GLXContext m_loadCtx = 0;
+    /* One load context per client loading thread */
+    std::mutex m_loadCtxLock;
+    std::vector<GLXContext> m_loadCtxs;
+    ThreadLocalPtr<std::remove_pointer<GLXContext>::type> m_threadLoadCtx;
 
     std::thread m_vsyncThread;
     bool m_vsyncRunning;
@@ -403,11 +409,9 @@ public:
             glXDestroyWindow(m_xDisp, m_glxWindow);
             m_glxWindow = 0;
         }
-        if (m_loadCtx)
-        {
-            glXDestroyContext(m_xDisp, m_loadCtx);
-            m_loadCtx = nullptr;
-        }
+        for (GLXContext loadCtx : m_loadCtxs)
+            glXDestroyContext(m_xDisp, loadCtx);
+        m_loadCtxs.clear();
         if (m_vsyncRunning)
         {
             m_vsyncRunning = false;
@@ -577,16 +581,20 @@ public:
     IGraphicsDataFactory* getLoadContextDataFactory()
     {
         XLockDisplay(m_xDisp);
-        if (!m_loadCtx)
+        GLXContext loadCtx = m_threadLoadCtx.get();
+        if (!loadCtx)
         {
             s_glxError = false;
             XErrorHandler oldHandler = XSetErrorHandler(ctxErrorHandler);
-            m_loadCtx = glXCreateContextAttribsARB(m_xDisp, m_fbconfig, m_glxCtx, True, ContextAttribList[m_attribIdx]);
+            loadCtx = glXCreateContextAttribsARB(m_xDisp, m_fbconfig, m_glxCtx, True, ContextAttribList[m_attribIdx]);
             XSetErrorHandler(oldHandler);
-            if (!m_loadCtx)
+            if (!loadCtx)
                 Log.report(logvisor::Fatal, "unable to make load GLX context");
+            m_threadLoadCtx.reset(loadCtx);
+            std::unique_lock<std::mutex> lk(m_loadCtxLock);
+            m_loadCtxs.push_back(loadCtx);
         }
-        if (!glXMakeContextCurrent(m_xDisp, m_glxWindow, m_glxWindow, m_loadCtx))
+        if (!glXMakeContextCurrent(m_xDisp, m_glxWindow, m_glxWindow, loadCtx))
             Log.report(logvisor::Fatal, "unable to make load GLX context current");
         XUnlockDisplay(m_xDisp);
         return getDataFactory();
@@ -1577,6 +1585,7 @@ public:
 
     void _incomingEvent(void* e)
     {
+        BOO_TRACE_ZONE("Window Event");
         XEvent* event = (XEvent*)e;
         switch (event->type)
         {
@@ -57,6 +57,16 @@ set (SIMD_C_FLAG_CANDIDATES
 
 set (SIMD_C_TEST_SOURCE
 "
+#if defined(__aarch64__)
+#include <arm_neon.h>
+int main()
+{
+  float vals[4] = {0};
+  float32x4_t a = vld1q_f32 (vals);
+  vst1q_f32 (vals, vaddq_f32 (a, a));
+  return 0;
+}
+#else
 #include <xmmintrin.h>
 int main()
 {
@@ -68,6 +78,7 @@ int main()
   _mm_storeu_ps (vals,b);
   return 0;
 }
+#endif
 ")
 
 if (DEFINED SIMD_C_FLAGS)
@@ -166,7 +166,7 @@ soxr_io_spec_t soxr_io_spec(
 #if HAVE_SIMD
 static bool cpu_has_simd(void)
 {
-#if defined __x86_64__ || defined _M_X64
+#if defined __x86_64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64
   return true;
 #elif defined __GNUC__ && defined i386
   uint32_t eax, ebx, ecx, edx;
@@ -248,7 +248,7 @@ soxr_t soxr_create(
       memcpy(&p->control_block,
           (p->q_spec.flags & SOXR_VR)? &_soxr_vr32_cb :
 #if HAVE_SIMD
-          cpu_has_simd()? &_soxr_rate32s_cb :
+          (!(p->runtime_spec.flags & SOXR_NO_SIMD) && cpu_has_simd())? &_soxr_rate32s_cb :
 #endif
           &_soxr_rate32_cb, sizeof(p->control_block));
     }
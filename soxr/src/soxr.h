@@ -271,6 +271,7 @@ struct soxr_runtime_spec {                                       /* Typically */
 
 #define SOXR_STRICT_BUFFERING  4u  /* Reserved for future use. */
 #define SOXR_NOSMALLINTOPT     8u  /* For test purposes only. */
+#define SOXR_NO_SIMD          16u  /* Use scalar fixed-rate kernel even if SIMD is available. */
 
 
 
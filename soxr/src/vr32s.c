@@ -643,7 +643,7 @@ static char const * vr_create(void * channel, void * shared,double max_io_ratio,
 
 static char const * vr_id(void)
 {
-  return "single-precision variable-rate";
+  return "single-precision variable-rate-SIMD";
 }
 
 typedef void (* fn_t)(void);